@@ -0,0 +1,383 @@
+/*
+Benchmarks of the shared C library deathcurve.c, built with 'make bench'.
+
+It includes deathcurve.c itself to reach the kernels and the steps of
+the hill climbing, and prints a JSON document with, for each cohort:
+- "kernels": the time per bin of the log-likelihood of each of the ten
+  functions at each polynomial order,
+- "steps": the latency of one step of the hill climbing (all the grid
+  points of a step, with the cache cleared) for each number of threads,
+- "fits": the time and the number of evaluations of a whole fit of the
+  chosen functions and signs with each optimizer.
+
+The cohorts are synthetic, with the numbers of rows from --rows, and the
+real data from the CSV files given with --csv (the columns age and
+outcome, with or without a header line), e.g., the cases selected by
+script.py. Run './bench --help' for the other options.
+
+Copyright (C) 2020  Alexander Yuryatin
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "deathcurve.c"
+
+#define MAX_COHORTS 16
+#define MAX_THREAD_COUNTS 16
+
+struct cohort {
+    char name[64];
+    double * ages;
+    int * outcomes;
+    int rows;
+};
+
+struct options {
+    long long rows[MAX_COHORTS];
+    int rowsNumber;
+    const char * csv[MAX_COHORTS];
+    int csvNumber;
+    double ageResolution;           // the synthetic ages are rounded to it, so that it sets the number of bins
+    double seconds;                 // the least time of each kernel measurement
+    int threads[MAX_THREAD_COUNTS];
+    int threadsNumber;
+    int stepOrder, stepFunction, steps;
+    int fitOrder, fitSigns, fitOneSign, fitThreads;
+    int fitFunctions[TOTAL_NUMBER_OF_FUNCTIONS];
+    int kernels, stepsOn, fits;     // the sections to run
+};
+
+/* the ages are uniform from 0 to 100 years and the deaths follow a logistic curve of the age with the crude mortality of about 5% */
+static void syntheticCohort(struct cohort * cohort, long long rows, double ageResolution) {
+    snprintf(cohort->name, sizeof(cohort->name), "synthetic-%lld", rows);
+    cohort->rows = (int) rows;
+    cohort->ages = malloc(rows * sizeof(double));
+    cohort->outcomes = malloc(rows * sizeof(int));
+    uint64_t state = 12345;
+    for (long long i = 0; i < rows; ++i) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        double age = (state >> 11) * (100.0 / 9007199254740992.0);
+        if (ageResolution > 0.0) age = floor(age / ageResolution) * ageResolution;
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        double u = (state >> 11) / 9007199254740992.0;
+        cohort->ages[i] = age;
+        cohort->outcomes[i] = u < 0.3 / (1.0 + exp(-(age - 75.0) / 8.0));
+    }
+}
+
+/* reads the columns age and outcome; returns -1 if the file cannot be read, has no rows, or the memory could not be
+allocated, with nothing left allocated */
+static int csvCohort(struct cohort * cohort, const char * path) {
+    FILE * fp = fopen(path, "r");
+    if (!fp) return -1;
+    const char * name = strrchr(path, '/');
+    snprintf(cohort->name, sizeof(cohort->name), "%s", name ? name + 1 : path);
+    int capacity = 1024, failed = 0;
+    cohort->rows = 0;
+    cohort->ages = malloc(capacity * sizeof(double));
+    cohort->outcomes = malloc(capacity * sizeof(int));
+    char line[256];
+    while (cohort->ages && cohort->outcomes && !failed && fgets(line, sizeof(line), fp)) {
+        char * end;
+        double age = strtod(line, &end);
+        if (end == line || (* end != ',' && * end != ';' && * end != '\t')) continue;     // the header or a blank line
+        double outcome = strtod(end + 1, NULL);
+        if (cohort->rows == capacity) {
+            capacity *= 2;
+            double * ages = realloc(cohort->ages, capacity * sizeof(double));
+            if (ages) cohort->ages = ages;
+            int * outcomes = realloc(cohort->outcomes, capacity * sizeof(int));
+            if (outcomes) cohort->outcomes = outcomes;
+            failed = !ages || !outcomes;
+            if (failed) continue;
+        }
+        cohort->ages[cohort->rows] = age;
+        cohort->outcomes[cohort->rows++] = outcome != 0.0;
+    }
+    fclose(fp);
+    if (!cohort->ages || !cohort->outcomes || failed || !cohort->rows) {
+        free(cohort->ages);
+        free(cohort->outcomes);
+        cohort->ages = NULL;
+        cohort->outcomes = NULL;
+        cohort->rows = 0;
+        return -1;
+    }
+    return 0;
+}
+
+static const char * simdName(void) {
+#if SIMD_KERNELS
+    pthread_once(&simdOnce_g, detectSimd);
+    if (simdLevel_g == 2) return "avx512";
+    if (simdLevel_g == 1) return "avx2";
+#endif
+    return "scalar";
+}
+
+static int compareDoubles(const void * a, const void * b) {
+    double x = * (const double *) a, y = * (const double *) b;
+    return (x > y) - (x < y);
+}
+
+/* the time per bin of each kernel at the powers where the hill climbing starts */
+static void benchKernels(const struct cohort * cohort, const struct options * options) {
+    printf(",\n      \"kernels\": [");
+    int first = 1;
+    for (int order = 2; order <= 7; ++order) {
+        dcContext * ctx = dcCreate(cohort->ages, cohort->outcomes, cohort->rows, order);
+        double origin[8], coefficients[8];
+        seedOrigin(order, origin);
+        for (int i = 0; i < 8; ++i)
+            coefficients[i] = pow(10.0, origin[i]);
+        for (int func = 0; func < TOTAL_NUMBER_OF_FUNCTIONS; ++func) {
+            double (*kernel)(const struct binnedData *, const double *, double, int *) = kernelFor(func, order);
+            volatile double sink = 0.0;
+            long long calls = 0;
+            int abandoned = 0;
+            double start = monotonicSeconds(), elapsed;
+            do {
+                for (int i = 0; i < 16; ++i)
+                    sink += kernel(&ctx->data, coefficients, -INFINITY, &abandoned);
+                calls += 16;
+            } while ((elapsed = monotonicSeconds() - start) < options->seconds);
+            double perBin = elapsed * 1e9 / ((double) calls * (ctx->data.bins ? ctx->data.bins : 1));
+            printf("%s\n        {\"function\": %d, \"order\": %d, \"calls\": %lld, \"ns_per_bin\": %.4f, \"bins_per_second\": %.6e}",
+                   first ? "" : ",", func, order, calls, perBin, 1e9 / perBin);
+            first = 0;
+        }
+        dcDestroy(ctx);
+    }
+    printf("\n      ]");
+}
+
+/* the latency of the first steps of the hill climbing from the seeds, each with all its grid points evaluated */
+static void benchSteps(const struct cohort * cohort, const struct options * options) {
+    dcContext * ctx = dcCreate(cohort->ages, cohort->outcomes, cohort->rows, options->stepOrder);
+    int points = (GRID_SIZE - ctx->start + ctx->skip - 1) / ctx->skip;
+    double * latencies = malloc(options->steps * sizeof(double));
+    printf(",\n      \"steps\": [");
+    for (int t = 0; t < options->threadsNumber; ++t) {
+        struct fitTask task;
+        memset(&task, 0, sizeof(task));
+        task.ctx = ctx;
+        task.func = options->stepFunction;
+        task.kernel = kernelFor(task.func, options->stepOrder);
+        task.result = malloc(GRID_SIZE * sizeof(double));
+        task.abandonedPoint = malloc(GRID_SIZE);
+        task.pending = malloc(GRID_SIZE * sizeof(int));
+        task.cache.capacity = CACHE_INITIAL_CAPACITY;
+        task.cache.entries = calloc(task.cache.capacity, sizeof(struct cacheEntry));
+        convertSigns(&task);
+        seedOrigin(options->stepOrder, task.origin);
+        /* no fits are listed, so the workers only take the chunks of the steps posted below */
+        struct workerPool pool;
+        memset(&pool, 0, sizeof(pool));
+        if (poolCreate(&pool, options->threads[t], NULL, 0, points) < 0) {
+            if (pool.threads) poolDestroy(&pool);
+            fprintf(stderr, "bench: cannot start %d threads\n", options->threads[t]);
+            exit(1);
+        }
+        double result = 0.0;
+        for (int step = 0; step < options->steps; ++step) {
+            cacheClear(&task.cache);
+            double start = monotonicSeconds();
+            int position = oneStep(&pool, &task, &result);
+            latencies[step] = monotonicSeconds() - start;
+            latticeKey(&task, position, task.lattice);
+        }
+        poolDestroy(&pool);
+        qsort(latencies, options->steps, sizeof(double), compareDoubles);
+        printf("%s\n        {\"function\": %d, \"order\": %d, \"threads\": %d, \"points\": %d, \"steps\": %d, \"evaluations\": %lld, \"abandoned\": %lld, \"median_us\": %.3f, \"min_us\": %.3f, \"max_us\": %.3f, \"ml\": %.10f}",
+               t ? "," : "", task.func, options->stepOrder, options->threads[t], points, options->steps,
+               (long long) atomic_load(&task.evaluations), (long long) atomic_load(&task.abandoned),
+               latencies[options->steps / 2] * 1e6, latencies[0] * 1e6, latencies[options->steps - 1] * 1e6, result);
+        free(task.result);
+        free(task.abandonedPoint);
+        free(task.pending);
+        free(task.cache.entries);
+    }
+    printf("\n      ]");
+    free(latencies);
+    dcDestroy(ctx);
+}
+
+/* the whole fit of the chosen functions and signs with each optimizer, which also compares their ML estimates */
+static void benchFits(const struct cohort * cohort, const struct options * options) {
+    static const char * optimizerNames[] = {"lattice", "lbfgs"};
+    printf(",\n      \"fits\": [");
+    for (int optimizer = DC_OPTIMIZER_LATTICE; optimizer <= DC_OPTIMIZER_LBFGS; ++optimizer) {
+        dcContext * ctx = dcCreate(cohort->ages, cohort->outcomes, cohort->rows, options->fitOrder);
+        dcSetThreads(ctx, options->fitThreads);
+        dcSetOptimizer(ctx, optimizer);
+        dcSetConsole(ctx, 0);
+        double output[9];
+        int sign1 = options->fitSigns;
+        double start = monotonicSeconds();
+        int function = dcFit(ctx, output, &sign1, options->fitOneSign, options->fitFunctions);
+        double elapsed = monotonicSeconds() - start;
+        dcCounters counters;
+        dcGetCounters(ctx, &counters);
+        printf("%s\n        {\"optimizer\": \"%s\", \"order\": %d, \"signs\": %d, \"one_sign\": %d, \"threads\": %d, \"seconds\": %.6f, \"evaluations\": %lld, \"abandoned\": %lld, \"cache_hits\": %lld, \"function\": %d, \"fitted_signs\": %d, \"ml\": %.10f}",
+               optimizer ? "," : "", optimizerNames[optimizer], options->fitOrder, options->fitSigns, options->fitOneSign, options->fitThreads,
+               elapsed, counters.evaluations, counters.abandoned, counters.cacheHits, function, sign1, output[8]);
+        dcDestroy(ctx);
+    }
+    printf("\n      ]");
+}
+
+static int parseList(const char * text, long long * values, int capacity) {
+    int number = 0;
+    char * end;
+    while (* text && number < capacity) {
+        values[number++] = (long long) strtod(text, &end);     // strtod accepts 1e6 as well
+        if (end == text) return -1;
+        text = * end == ',' ? end + 1 : end;
+    }
+    return number;
+}
+
+static void usage(void) {
+    fputs("usage: bench [options]\n"
+          "  --rows N[,N...]         synthetic cohorts of these numbers of rows (1000,100000)\n"
+          "  --age-resolution Y      the synthetic ages are rounded to Y years, 0 leaves them continuous (0.1)\n"
+          "  --csv FILE              a cohort from a CSV file with the columns age and outcome (may be repeated)\n"
+          "  --no-synthetic          only the cohorts from the CSV files\n"
+          "  --sections LIST         any of kernels,steps,fits (all)\n"
+          "  --seconds S             the least time of each kernel measurement (0.1)\n"
+          "  --threads N[,N...]      the numbers of threads of the steps (1,2,4,... up to the online CPU cores)\n"
+          "  --step-order N          the polynomial order of the steps (5)\n"
+          "  --step-function N       the function of the steps (0)\n"
+          "  --steps N               the number of steps timed for each number of threads (20)\n"
+          "  --fit-order N           the polynomial order of the fits (3)\n"
+          "  --fit-functions DIGITS  the functions of the fits (0)\n"
+          "  --fit-signs N           the signs of the fits coded as in dcFit (0)\n"
+          "  --all-signs             the fits go from those signs up to all negative\n"
+          "  --fit-threads N         the threads of the fits, 0 means one per online CPU core (0)\n", stderr);
+}
+
+int main(int argc, char ** argv) {
+    struct options options;
+    memset(&options, 0, sizeof(options));
+    options.rows[0] = 1000;
+    options.rows[1] = 100000;
+    options.rowsNumber = 2;
+    options.ageResolution = 0.1;
+    options.seconds = 0.1;
+    options.stepOrder = 5;
+    options.steps = 20;
+    options.fitOrder = 3;
+    options.fitOneSign = 1;
+    options.fitFunctions[0] = 1;
+    options.kernels = options.stepsOn = options.fits = 1;
+    int cores = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1) cores = 1;
+    for (int threads = 1; threads < 2 * cores && options.threadsNumber < MAX_THREAD_COUNTS; threads *= 2)
+        options.threads[options.threadsNumber++] = threads < cores ? threads : cores;
+    long long values[MAX_COHORTS > MAX_THREAD_COUNTS ? MAX_COHORTS : MAX_THREAD_COUNTS];
+    for (int i = 1; i < argc; ++i) {
+        const char * argument = argv[i];
+        const char * value = i + 1 < argc ? argv[i + 1] : NULL;
+        int takesValue = strcmp(argument, "--no-synthetic") && strcmp(argument, "--all-signs") && strcmp(argument, "--help");
+        if (takesValue && !value) {
+            usage();
+            return 2;
+        }
+        if (!strcmp(argument, "--rows")) {
+            if ((options.rowsNumber = parseList(value, options.rows, MAX_COHORTS)) < 0) { usage(); return 2; }
+        } else if (!strcmp(argument, "--age-resolution"))
+            options.ageResolution = atof(value);
+        else if (!strcmp(argument, "--csv")) {
+            if (options.csvNumber < MAX_COHORTS) options.csv[options.csvNumber++] = value;
+        } else if (!strcmp(argument, "--no-synthetic"))
+            options.rowsNumber = 0;
+        else if (!strcmp(argument, "--sections")) {
+            options.kernels = strstr(value, "kernels") != NULL;
+            options.stepsOn = strstr(value, "steps") != NULL;
+            options.fits = strstr(value, "fits") != NULL;
+        } else if (!strcmp(argument, "--seconds"))
+            options.seconds = atof(value);
+        else if (!strcmp(argument, "--threads")) {
+            int number = parseList(value, values, MAX_THREAD_COUNTS);
+            if (number <= 0) { usage(); return 2; }
+            options.threadsNumber = number;
+            for (int t = 0; t < number; ++t)
+                options.threads[t] = values[t] > 0 ? (int) values[t] : 1;
+        } else if (!strcmp(argument, "--step-order"))
+            options.stepOrder = atoi(value);
+        else if (!strcmp(argument, "--step-function"))
+            options.stepFunction = atoi(value);
+        else if (!strcmp(argument, "--steps"))
+            options.steps = atoi(value);
+        else if (!strcmp(argument, "--fit-order"))
+            options.fitOrder = atoi(value);
+        else if (!strcmp(argument, "--fit-functions")) {
+            memset(options.fitFunctions, 0, sizeof(options.fitFunctions));
+            for (const char * digit = value; * digit; ++digit)
+                if (* digit >= '0' && * digit <= '9') options.fitFunctions[* digit - '0'] = 1;
+        } else if (!strcmp(argument, "--fit-signs"))
+            options.fitSigns = atoi(value);
+        else if (!strcmp(argument, "--all-signs"))
+            options.fitOneSign = 0;
+        else if (!strcmp(argument, "--fit-threads"))
+            options.fitThreads = atoi(value);
+        else {
+            usage();
+            return strcmp(argument, "--help") ? 2 : 0;
+        }
+        if (takesValue) ++i;
+    }
+    if (options.stepOrder < 2 || options.stepOrder > 7 || options.fitOrder < 2 || options.fitOrder > 7
+        || options.stepFunction < 0 || options.stepFunction >= TOTAL_NUMBER_OF_FUNCTIONS || options.steps < 1) {
+        usage();
+        return 2;
+    }
+
+    struct cohort cohorts[2 * MAX_COHORTS];
+    int cohortsNumber = 0;
+    for (int i = 0; i < options.rowsNumber; ++i)
+        syntheticCohort(&cohorts[cohortsNumber++], options.rows[i], options.ageResolution);
+    for (int i = 0; i < options.csvNumber; ++i) {
+        if (csvCohort(&cohorts[cohortsNumber], options.csv[i]) < 0) {
+            fprintf(stderr, "bench: cannot read the cohort from %s\n", options.csv[i]);
+            return 1;
+        }
+        ++cohortsNumber;
+    }
+
+    printf("{\n  \"simd\": \"%s\",\n  \"cores\": %d,\n  \"cohorts\": [", simdName(), cores);
+    for (int c = 0; c < cohortsNumber; ++c) {
+        struct cohort * cohort = &cohorts[c];
+        int deaths = 0;
+        for (int i = 0; i < cohort->rows; ++i)
+            deaths += cohort->outcomes[i] != 0;
+        /* the binning is timed as well, since it is all the work that grows with the rows rather than with the distinct ages */
+        double start = monotonicSeconds();
+        dcContext * ctx = dcCreate(cohort->ages, cohort->outcomes, cohort->rows, 2);
+        double binning = monotonicSeconds() - start;
+        printf("%s\n    {\n      \"name\": \"%s\", \"rows\": %d, \"deaths\": %d, \"bins\": %d, \"binning_seconds\": %.6f",
+               c ? "," : "", cohort->name, cohort->rows, deaths, ctx->data.bins, binning);
+        dcDestroy(ctx);
+        if (options.kernels) benchKernels(cohort, &options);
+        if (options.stepsOn) benchSteps(cohort, &options);
+        if (options.fits) benchFits(cohort, &options);
+        printf("\n    }");
+        fflush(stdout);
+        free(cohort->ages);
+        free(cohort->outcomes);
+    }
+    printf("\n  ]\n}\n");
+    return 0;
+}
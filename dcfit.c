@@ -0,0 +1,466 @@
+/*
+The command-line fitting driver of the shared C library deathcurve.c,
+built with 'make dcfit', for batch jobs without Python.
+
+It reads a cohort from a binary columnar file, which it maps into memory,
+or from a CSV file with the columns age and outcome, fits the functions
+with deathcurve.c, and writes the same report as bestFit.reportModel()
+of the Python wrapper. Run './dcfit --help' for the options.
+
+The binary columnar file, which deathcurve.writeCohort() writes, is
+little-endian:
+- 8 bytes: the magic "DCCOHORT"
+- 4 bytes: the version of the format, 1
+- 4 bytes: reserved, 0
+- 8 bytes: the number of rows n
+- n float64: the ages
+- n int32: the outcomes (non-zero means death)
+
+Copyright (C) 2020  Alexander Yuryatin
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "deathcurve.h"
+
+#define COHORT_HEADER_SIZE 24
+#define COHORT_VERSION 1
+
+struct cohort {
+    const double * ages;
+    const int * outcomes;
+    long long rows;
+    void * mapping;                 // the mapped binary file, or NULL if the columns were read from a CSV file
+    size_t mappingSize;
+};
+
+static atomic_int interrupted;
+
+/* the first SIGINT or SIGTERM stops the fit after its current steps, as stop.txt does, and the second one kills the process */
+static void interruptHandler(int signal) {
+    atomic_store(&interrupted, 1);
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = SIG_DFL;
+    sigaction(signal, &action, NULL);
+}
+
+/* returns -1 if the file is not a cohort of this version */
+static int mapCohort(struct cohort * cohort, int fd, size_t size) {
+    unsigned char header[COHORT_HEADER_SIZE];
+    uint16_t endianness = 1;
+    if (* (unsigned char *) &endianness != 1) return -1;     // the columns are read in place, so the machine must be little-endian
+    if (size < COHORT_HEADER_SIZE || pread(fd, header, COHORT_HEADER_SIZE, 0) != COHORT_HEADER_SIZE) return -1;
+    uint32_t version;
+    uint64_t rows;
+    memcpy(&version, header + 8, 4);
+    memcpy(&rows, header + 16, 8);
+    if (memcmp(header, "DCCOHORT", 8) || version != COHORT_VERSION || rows > INT32_MAX || size != COHORT_HEADER_SIZE + rows * 12) return -1;
+    cohort->mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (cohort->mapping == MAP_FAILED) return -1;
+    cohort->mappingSize = size;
+    madvise(cohort->mapping, size, MADV_SEQUENTIAL);
+    cohort->ages = (const double *) ((const char *) cohort->mapping + COHORT_HEADER_SIZE);
+    cohort->outcomes = (const int *) ((const char *) cohort->mapping + COHORT_HEADER_SIZE + rows * 8);
+    cohort->rows = (long long) rows;
+    return 0;
+}
+
+/* reads the columns age and outcome separated by commas, semicolons, or tabs, skipping the header; returns -1 if there are no rows
+or the memory could not be allocated, with nothing left allocated */
+static int readCsvCohort(struct cohort * cohort, FILE * fp) {
+    long long capacity = 65536;
+    double * ages = malloc(capacity * sizeof(double));
+    int * outcomes = malloc(capacity * sizeof(int));
+    char line[256];
+    int failed = 0;
+    cohort->rows = 0;
+    while (ages && outcomes && !failed && fgets(line, sizeof(line), fp)) {
+        char * end;
+        double age = strtod(line, &end);
+        if (end == line || (* end != ',' && * end != ';' && * end != '\t')) continue;     // the header or a blank line
+        double outcome = strtod(end + 1, NULL);
+        if (cohort->rows == capacity) {
+            capacity *= 2;
+            double * grownAges = realloc(ages, capacity * sizeof(double));
+            if (grownAges) ages = grownAges;
+            int * grownOutcomes = realloc(outcomes, capacity * sizeof(int));
+            if (grownOutcomes) outcomes = grownOutcomes;
+            failed = !grownAges || !grownOutcomes;
+            if (failed) continue;
+        }
+        ages[cohort->rows] = age;
+        outcomes[cohort->rows++] = outcome != 0.0;
+    }
+    cohort->mapping = NULL;
+    if (!ages || !outcomes || failed || !cohort->rows) {
+        free(ages);
+        free(outcomes);
+        cohort->ages = NULL;
+        cohort->outcomes = NULL;
+        cohort->rows = 0;
+        return -1;
+    }
+    cohort->ages = ages;
+    cohort->outcomes = outcomes;
+    return 0;
+}
+
+static int openCohort(struct cohort * cohort, const char * path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat status;
+    char magic[8];
+    if (fstat(fd, &status) == 0 && pread(fd, magic, 8, 0) == 8 && !memcmp(magic, "DCCOHORT", 8)) {
+        int result = mapCohort(cohort, fd, (size_t) status.st_size);
+        close(fd);
+        return result;
+    }
+    FILE * fp = fdopen(fd, "r");
+    if (!fp) {
+        close(fd);
+        return -1;
+    }
+    int result = readCsvCohort(cohort, fp);
+    fclose(fp);
+    return result;
+}
+
+static void closeCohort(struct cohort * cohort) {
+    if (cohort->mapping)
+        munmap(cohort->mapping, cohort->mappingSize);
+    else {
+        free((void *) cohort->ages);
+        free((void *) cohort->outcomes);
+    }
+}
+
+/* the second largest age, which ends the range of the plots of the report as in the Python wrapper */
+static double submaxAge(const struct cohort * cohort) {
+    double largest = -INFINITY, second = -INFINITY;
+    for (long long i = 0; i < cohort->rows; ++i) {
+        double age = cohort->ages[i];
+        if (age >= largest) {
+            second = largest;
+            largest = age;
+        } else if (age > second)
+            second = age;
+    }
+    return cohort->rows > 1 ? second : largest;
+}
+
+/* The report below is that of bestFit.output() of the Python wrapper, with the same templates, where {0} to {7} are
+replaced with the same arguments */
+
+static const char * reportTemplates[10] = {
+    "\n\n\tPython\n\tfrom scipy.special import erf\n\t{5}erf(math.log({0})) * 0.5 + 0.5\n\n\t"
+    "Microsoft Excel\n\tERF(LN({1}))/2 + 0.5\n\n\t"
+    "WolframAlpha\n\tplot | erf(log({2}))/2 + 0.5 | x = {6} to {7}\n\n",
+    "\n\n\tPython\n\tfrom scipy.special import erf\n\t{5}erf(math.log({0})) * (0.5 - {4}) + 0.5 - {4} + {3}\n\n\t"
+    "Microsoft Excel\n\tERF(LN({1})) * (0.5 - {4}) + 0.5 - {4} + {3}\n\n\t"
+    "WolframAlpha\n\tplot | erf(log({2})) * (0.5 - {4}) + 0.5 - {4} + {3} | x = {6} to {7}\n\n",
+    "\n\n\tPython\n\t{5}math.tanh(math.log({0}))/2 + 0.5\n\n\t"
+    "Microsoft Excel\n\tTANH(LN({1}))/2 + 0.5\n\n\t"
+    "WolframAlpha\n\tplot | tanh(log({2}))/2 + 0.5 | x = {6} to {7}\n\n",
+    "\n\n\tPython\n\t{5}math.tanh(math.log({0})) * (0.5 - {4}) + 0.5 - {4} + {3}\n\n\t"
+    "Microsoft Excel\n\tTANH(LN({1})) * (0.5 - {4}) + 0.5 - {4} + {3}\n\n\t"
+    "WolframAlpha\n\tplot | tanh(log({2})) * (0.5 - {4}) + 0.5 - {4} + {3} | x = {6} to {7}\n\n",
+    "\n\n\tPython\n\t{5}2.0 * math.atan(math.tanh(math.log({0})))/math.pi + 0.5\n\n\t"
+    "Microsoft Excel\n\t2.0 * ATAN(TANH(LN({1})))/ PI() + 0.5\n\n\t"
+    "WolframAlpha\n\tplot | 2.0 * atan(tanh(log({2})))/pi + 0.5 | x = {6} to {7}\n\n\n",
+    "\n\n\tPython\n\t{5}4.0 * (0.5 - {4}) * math.atan(math.tanh(math.log({0})))/math.pi + 0.5 - {4} + {3}\n\n\t"
+    "Microsoft Excel\n\t4.0 * (0.5 - {4}) * ATAN(TANH(LN({1})))/ PI() + 0.5 - {4} + {3}\n\n\t"
+    "WolframAlpha\n\tplot | 4.0 * (0.5 - {4}) * atan(tanh(log({2})))/pi + 0.5 - {4} + {3} | x = {6} to {7}\n\n\n",
+    "\n\n\tPython\n\t{5}0.5 * (math.log({0}) )/((1 + (math.log({0}))**2)**0.5) + 0.5\n\n\t"
+    "Microsoft Excel\n\t0.5 * (LN({1}) )/((1 + (LN({1}))^2)^0.5) + 0.5\n\n\t"
+    "WolframAlpha\n\tplot | 0.5 * (log({2}) )/((1 + (log({2}))^2)^0.5) + 0.5 | x = {6} to {7}\n\n",
+    "\n\n\tPython\n\t{5}(0.5 - {4}) * (math.log({0}) )/((1 + (math.log({0}))**2)**0.5) + 0.5 - {4} + {3}\n\n\t"
+    "Microsoft Excel\n\t(0.5 - {4}) * (LN({1}) )/((1 + (LN({1}))^2)^0.5) + 0.5 - {4} + {3}\n\n\t"
+    "WolframAlpha\n\tplot | (0.5 - {4}) * (log({2}) )/((1 + (log({2}))^2)^0.5) + 0.5 - {4} + {3} | x = {6} to {7}\n\n",
+    "\n\n\tPython\n\t{5}0.5 * (math.log({0}) )/(1 + abs(math.log({0}))) + 0.5\n\n\t"
+    "Microsoft Excel\n\t0.5 * (LN({1}) )/(1 + ABS(LN({1}))) + 0.5\n\n\t"
+    "WolframAlpha\n\tplot | 0.5 * log({2})/(1 + abs(log({2}))) + 0.5 | x = {6} to {7}\n\n",
+    "\n\n\tPython\n\t{5}(0.5 - {4}) * (math.log({0}) )/(1 + abs(math.log({0}))) + 0.5 - {4} + {3}\n\n\t"
+    "Microsoft Excel\n\t(0.5 - {4}) * (LN({1}) )/(1 + ABS(LN({1}))) + 0.5 - {4} + {3}\n\n\t"
+    "WolframAlpha\n\tplot |  (0.5 - {4}) * log({2})/(1 + abs(log({2}))) + 0.5 - {4} + {3} | x = {6} to {7}\n\n"
+};
+
+/* the polynomial of bestFit.outputLog() in the syntax of Python, Excel, or WolframAlpha */
+static void polynomialText(char * text, size_t size, const double * params, int length, const char * linear, const char * power) {
+    size_t used = 0;
+    int startSign = 0;
+    text[0] = '\0';
+    for (int i = 0; i < length && used < size; ++i) {
+        double par = params[i];
+        if (!par) continue;
+        if (startSign)
+            used += snprintf(text + used, size - used, par > 0.0 ? " + %.6e" : " - %.6e", fabs(par));
+        else
+            used += snprintf(text + used, size - used, "%.6e", par);
+        startSign = 1;
+        if (used >= size) break;
+        if (i == 1)
+            used += snprintf(text + used, size - used, "%s", linear);
+        else if (i > 1)
+            used += snprintf(text + used, size - used, power, i);
+    }
+}
+
+/* str() of a Python float: the shortest digits that read back as the same number, in fixed notation for the exponents from -4 to 15 */
+static void pythonFloat(char * text, size_t size, double value) {
+    char digits[32];
+    int precision = 1;
+    for (; precision < 17; ++precision) {
+        snprintf(digits, sizeof(digits), "%.*e", precision - 1, value);
+        if (strtod(digits, NULL) == value) break;
+    }
+    snprintf(digits, sizeof(digits), "%.*e", precision - 1, value);
+    int exponent = atoi(strchr(digits, 'e') + 1);
+    if (exponent >= -4 && exponent < 16) {
+        int decimals = precision - 1 - exponent;
+        if (decimals > 0)
+            snprintf(text, size, "%.*f", decimals, value);
+        else
+            snprintf(text, size, "%.0f.0", value);
+    } else
+        snprintf(text, size, "%s", digits);
+}
+
+/* writes the report of the fitted function into the file, as bestFit.reportModel() does */
+static void writeReport(FILE * fp, int function, const double * output, double maxAge) {
+    double params[8];
+    /* the functions with the floor and ceiling keep them in the first two coefficients, which bestFit moves to the end */
+    for (int i = 0; i < 8; ++i)
+        params[i] = function % 2 ? output[(i + 2) % 8] : output[i];
+    int length = function % 2 ? 5 : 7;
+    char arguments[8][1024];
+    polynomialText(arguments[0], sizeof(arguments[0]), params, length, "*x", "*(x**%d)");
+    polynomialText(arguments[1], sizeof(arguments[1]), params, length, "*A1", "*(A1^%d)");
+    polynomialText(arguments[2], sizeof(arguments[2]), params, length, " x", " x^%d");
+    snprintf(arguments[3], sizeof(arguments[3]), "%e", params[6]);
+    snprintf(arguments[4], sizeof(arguments[4]), "%e", params[7]);
+    double start = ceil(-params[0] * 1e6) * 1e-6 + 0.0;     // + 0.0 turns -0.0 into 0.0, since Python's ceil() returns an integer
+    char startText[64];
+    pythonFloat(startText, sizeof(startText), start);
+    if (params[0] < 0.0)
+        snprintf(arguments[5], sizeof(arguments[5]), "0.0 if x < %.6f else ", start);
+    else
+        arguments[5][0] = '\0';
+    snprintf(arguments[6], sizeof(arguments[6]), "%s", startText);
+    snprintf(arguments[7], sizeof(arguments[7]), "%.0f", maxAge);
+    fputs("\nBest fit is:", fp);
+    for (const char * c = reportTemplates[function]; * c; ++c) {
+        if (c[0] == '{' && c[1] >= '0' && c[1] <= '7' && c[2] == '}') {
+            fputs(arguments[c[1] - '0'], fp);
+            c += 2;
+        } else
+            fputc(* c, fp);
+    }
+}
+
+/* prints the report and writes it into the file; returns the exit status */
+static int report(const char * path, int function, const double * output, double maxAge) {
+    writeReport(stdout, function, output, maxAge);
+    putchar('\n');
+    FILE * fp = fopen(path, "w");
+    if (!fp) {
+        fprintf(stderr, "dcfit: cannot write the report to %s\n", path);
+        return 1;
+    }
+    writeReport(fp, function, output, maxAge);
+    fclose(fp);
+    return 0;
+}
+
+static void usage(void) {
+    fputs("usage: dcfit [options] FILE\n"
+          "       dcfit [--report FILE] --merge FILE...\n"
+          "FILE is a binary columnar cohort (see the header of dcfit.c) or a CSV file with the columns age and outcome\n"
+          "  --signs SIGNS           the signs of the coefficients, e.g., \"++++++++\" or \"-+-+\" (all positive)\n"
+          "  --one-sign              fit the signs of --signs only instead of all the signs from them up to \"--------\"\n"
+          "  --functions DIGITS      the numbers of the functions to fit, e.g., 024 (0123456789)\n"
+          "  --order N               the order of the internal polynomial from 2 to 7 (5)\n"
+          "  --threads N             the threads, 0 means one per online CPU core (0)\n"
+          "  --optimizer NAME        lattice or lbfgs (lattice)\n"
+          "  --checkpoint FILE       write checkpoints to FILE\n"
+          "  --checkpoint-interval S the least number of seconds between two checkpoints (600)\n"
+          "  --resume                resume the fit saved in the checkpoint with its signs, functions, order, and optimizer\n"
+          "  --shard I/N             fit only the shard I from 0 to N - 1 of the functions with their signs, whose results\n"
+          "                          are saved in the checkpoint\n"
+          "  --merge                 report the best fit of the results of all the shards, the checkpoints given as FILE...\n"
+          "  --report FILE           the file of the report (report.txt)\n"
+          "  --quiet                 print no progress messages and no summary\n"
+          "The fit stops with the best results so far on SIGINT (Ctrl+C), SIGTERM, or when the file stop.txt appears.\n", stderr);
+}
+
+int main(int argc, char ** argv) {
+    const char * path = NULL, * checkpoint = NULL, * reportPath = "report.txt";
+    const char * signs = NULL, * functions = "0123456789";
+    int oneSign = 0, order = 5, threads = 0, optimizer = DC_OPTIMIZER_LATTICE, resume = 0, quiet = 0;
+    int shardIndex = 0, shardCount = 1, merge = 0, files = 0;
+    double checkpointInterval = 600.0;
+    for (int i = 1; i < argc; ++i) {
+        const char * argument = argv[i];
+        int flag = !strcmp(argument, "--one-sign") || !strcmp(argument, "--resume") || !strcmp(argument, "--quiet")
+                || !strcmp(argument, "--merge") || !strcmp(argument, "--help");
+        if (argument[0] != '-') {
+            argv[files++] = argv[i];     // the files are gathered at the start of argv, which is no longer needed there
+            continue;
+        }
+        if (!flag && i + 1 == argc) {
+            usage();
+            return 2;
+        }
+        const char * value = flag ? NULL : argv[++i];
+        if (!strcmp(argument, "--signs"))
+            signs = value;
+        else if (!strcmp(argument, "--one-sign"))
+            oneSign = 1;
+        else if (!strcmp(argument, "--functions"))
+            functions = value;
+        else if (!strcmp(argument, "--order"))
+            order = atoi(value);
+        else if (!strcmp(argument, "--threads"))
+            threads = atoi(value);
+        else if (!strcmp(argument, "--optimizer")) {
+            if (!strcmp(value, "lattice")) optimizer = DC_OPTIMIZER_LATTICE;
+            else if (!strcmp(value, "lbfgs")) optimizer = DC_OPTIMIZER_LBFGS;
+            else {
+                usage();
+                return 2;
+            }
+        } else if (!strcmp(argument, "--checkpoint"))
+            checkpoint = value;
+        else if (!strcmp(argument, "--checkpoint-interval"))
+            checkpointInterval = atof(value);
+        else if (!strcmp(argument, "--resume"))
+            resume = 1;
+        else if (!strcmp(argument, "--report"))
+            reportPath = value;
+        else if (!strcmp(argument, "--quiet"))
+            quiet = 1;
+        else if (!strcmp(argument, "--shard")) {
+            if (sscanf(value, "%d/%d", &shardIndex, &shardCount) != 2 || shardCount < 1 || shardIndex < 0 || shardIndex >= shardCount) {
+                usage();
+                return 2;
+            }
+        } else if (!strcmp(argument, "--merge"))
+            merge = 1;
+        else {
+            usage();
+            return strcmp(argument, "--help") ? 2 : 0;
+        }
+    }
+    if (merge) {
+        if (!files) {
+            usage();
+            return 2;
+        }
+        double output[9], maxAge;
+        int sign1;
+        int function = dcMergeShards((const char * const *) argv, files, output, &sign1, &maxAge);
+        if (function < 0) {
+            fputs(function == -2 ? "dcfit: a shard has not finished its fits, resume it first\n"
+                                 : "dcfit: the files are not the checkpoints of all the shards of one fit\n", stderr);
+            return 1;
+        }
+        return report(reportPath, function, output, maxAge);
+    }
+    path = files == 1 ? argv[0] : NULL;
+    if (!path || (resume && !checkpoint) || (shardCount > 1 && !checkpoint)) {
+        usage();
+        return 2;
+    }
+    int sign1 = 0;
+    if (signs) {
+        if (strlen(signs) > 8 || strspn(signs, "+-") != strlen(signs)) {
+            fputs("dcfit: the signs may only be up to eight '+' and '-'\n", stderr);
+            return 2;
+        }
+        for (int i = 0; signs[i]; ++i)
+            if (signs[i] == '-') sign1 |= 1 << i;
+    }
+    int functionsToTest[10] = {0};
+    for (const char * digit = functions; * digit; ++digit) {
+        if (* digit < '0' || * digit > '9') {
+            fputs("dcfit: the functions may only be digits\n", stderr);
+            return 2;
+        }
+        functionsToTest[* digit - '0'] = 1;
+    }
+    if (resume && ((order = dcCheckpointOrder(checkpoint)) < 0 || (shardCount = dcCheckpointShards(checkpoint)) < 0)) {
+        fprintf(stderr, "dcfit: %s is not a checkpoint\n", checkpoint);
+        return 1;
+    }
+
+    struct cohort cohort;
+    if (openCohort(&cohort, path) < 0) {
+        fprintf(stderr, "dcfit: cannot read the cohort from %s\n", path);
+        return 1;
+    }
+    long long deaths = 0;
+    for (long long i = 0; i < cohort.rows; ++i) {
+        if (!(cohort.ages[i] >= 0.0 && cohort.ages[i] <= 140.0)) {       // the range that the Python wrapper accepts
+            fprintf(stderr, "dcfit: the age %g in the row %lld is not between 0 and 140\n", cohort.ages[i], i + 1);
+            closeCohort(&cohort);
+            return 1;
+        }
+        deaths += cohort.outcomes[i] != 0;
+    }
+    double maxAge = submaxAge(&cohort);
+    dcContext * ctx = dcCreate(cohort.ages, cohort.outcomes, (int) cohort.rows, order);
+    closeCohort(&cohort);      // the context keeps its own bins of the ages
+    if (!ctx) {
+        fputs("dcfit: the order must be from 2 to 7\n", stderr);
+        return 2;
+    }
+    if (!quiet)
+        printf("%lld cases were selected with %lld deaths\n\n", cohort.rows, deaths);
+    dcSetThreads(ctx, threads);
+    dcSetOptimizer(ctx, optimizer);
+    dcSetConsole(ctx, !quiet);
+    dcSetStopFile(ctx, "stop.txt");
+    dcSetCancelFlag(ctx, &interrupted);
+    if (checkpoint) dcSetCheckpoint(ctx, checkpoint, checkpointInterval);
+    dcSetShard(ctx, shardIndex, shardCount);
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = interruptHandler;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    double output[9];
+    int function = resume ? dcResume(ctx, checkpoint, output, &sign1) : dcFit(ctx, output, &sign1, signs && oneSign, functionsToTest);
+    dcDestroy(ctx);
+    if (function < 0) {
+        fprintf(stderr, resume ? "dcfit: the checkpoint %s could not be read or is not of this cohort\n" : "dcfit: out of memory\n", checkpoint);
+        return 1;
+    }
+    if (shardCount > 1) {      // the best fit of a shard is not that of the cohort, so only the merge reports
+        if (!quiet) printf("\nThe results of the shard are in %s, which 'dcfit --merge' reads with those of the other shards\n", checkpoint);
+        return 0;
+    }
+    return report(reportPath, function, output, maxAge);
+}
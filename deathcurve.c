@@ -64,33 +64,87 @@ along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
 
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <float.h>
 #include <pthread.h>
 #include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include "deathcurve.h"
 
 /* The macro below was created instead of a function to avoid function call overhead */
 #define internalLogL(x, b0, b1, b2, b3, b4, b5, b6, b7) (b0 + b1 * x + b2 * pow(x, 2.0) + b3 * pow(x, 3.0) + b4 * pow(x, 4.0) + b5 * pow(x, 5.0) + b6 * pow(x, 6.0) + b7 * pow(x, 7.0))
 #define internalLogS(x, b0, b1, b2, b3, b4, b5) (b0 + b1 * x + b2 * pow(x, 2.0) + b3 * pow(x, 3.0) + b4 * pow(x, 4.0) + b5 * pow(x, 5.0))
 #define logVerified(x) ( (x <= 0.0) || (x > 1.0) ? -DBL_MAX : log(x) )
 #define indexConverter(x) (1 + (x > 0 ? (int)pow(3,1) : 0) + (x > 1 ? (int)pow(3,2) : 0) + (x > 2 ? (int)pow(3,3) : 0) + (x > 3 ? (int)pow(3,4) : 0) + (x > 4 ? (int)pow(3,5) : 0) + (x > 5 ? (int)pow(3,6) : 0) + (x > 6 ? (int)pow(3,7) : 0))
-#define THREADS_MAX 6561   // 3 ^ 8 — the former is the number of tests for each parameter per step, the latter is the number of fitted parameters. So many threads don't significantly impede performance in practice (though you may want to reassess that) but will use whatever number of CPU cores and threads your laptop, workstation, or server has.
+#define GRID_SIZE 6561   // 3 ^ 8 — the former is the number of tests for each parameter per step, the latter is the number of fitted parameters
+#define GRID_CENTER 3280   // the grid point with all the coefficients unchanged, which is where the previous step ended
+#define CACHE_INITIAL_CAPACITY 4096   // entries of the lattice cache of a fit, which doubles whenever it gets half full
+#define LBFGS_MEMORY 8         // the number of the latest steps that the L-BFGS optimizer keeps to approximate the Hessian
+#define LBFGS_ITERATIONS 500
+#define LBFGS_MAX_STEP 2.0     // the largest change of a power of a coefficient per iteration, i.e., 100 times
+#define PRUNING_BLOCK 16   // the kernels compare their running sum with the best point of the step after each block of this many bins
+#define PRUNING_MARGIN 1e-9   // the relative slack of that comparison, far above the rounding of summing the bins in another order
+#define SIMD_PADDING 8     // the bins are padded with empty ones to a multiple of the widest vector of doubles
+#define CHUNKS_PER_THREAD 4   // the grid points of one step are split into this many chunks per thread of the pool to even out the load
+#define MIN_POINTS_PER_THREAD 8   // below this, adding threads to one step costs more in synchronization than it saves
+#define MAX_SIGN_PATTERNS 256
+#define CHECKPOINT_VERSION 2
+#define BOOTSTRAP_ROUND 64   // the replicates of dcBootstrap resampled and queued at once, which bounds the memory of their cohorts
+#define POISSON_PTRS_MIN 10.0 // the Poisson counts of larger means are drawn with the transformed rejection, smaller ones by inversion
 #define START_FUNCTION 1   // this can be used to "hardcode" to fit fewer functions than added to this code
 #define STOP_FUNCTION 10   // this can be used to "hardcode" to fit fewer functions than added to this code
 #define TOTAL_NUMBER_OF_FUNCTIONS 10
 
-/* these variables were made global to make them accessible (read-only) to all threads */
-static char signString[9];
-static unsigned char signs;
-static int func_g, * outcome_g, length_g, precision_g, skip_g, start_g, order_g;
-static double b0_g, b1_g, b2_g, b3_g, b4_g, b5_g, b6_g, b7_g, * age_g, * result_g;
-/* variables to temporary hold the signs of coefficients within one 'sign' cycle were made global to avoid overhead of passing so many arguments for multiple times to an iterating function */
-static double s0_g, s1_g, s2_g, s3_g, s4_g, s5_g, s6_g, s7_g;
+/* The statements of the counters and timers of dcGetProfile, which are compiled only with -DDEATHCURVE_PROFILE */
+#ifdef DEATHCURVE_PROFILE
+#define PROFILE(...) __VA_ARGS__
+#else
+#define PROFILE(...)
+#endif
+
+/* the input data compressed into bins of distinct ages with the numbers of deaths and survivors in each of them
+(the numbers are kept as doubles to be multiplied by the log-likelihood terms directly) */
+struct binnedData {
+    int bins, binsPadded;
+    double * age, * deaths, * survivors;    // in the order of the ages, which the log-likelihood is summed in
+    double * prunedAge, * prunedDeaths, * prunedSurvivors;     // the same bins in the order of orderBins for abandoning the grid points
+};
+
+/* Everything a fit needs to know about the cohort and the lattice, which is read-only during the fits,
+so that any number of contexts can be fitted at once from different threads */
+struct dcContext {
+    struct binnedData data;
+    int polynOrder;
+    int order, start, skip;         // the slots of the grid that are varied for this polynomial order
+    int threads;                    // 0 means as many as there are online CPU cores
+    int optimizer;                  // DC_OPTIMIZER_LATTICE or DC_OPTIMIZER_LBFGS
+    char * checkpointPath;          // NULL when the fits write no checkpoints
+    double checkpointInterval;      // seconds
+    dcProgressCallback progress;    // NULL when the fits report no progress
+    void * progressData;
+    double progressInterval;        // seconds
+    const atomic_int * cancelFlag;  // the fits stop when the caller sets it
+    char * stopFile;                // NULL when the fits look for no stop signal file
+    int console;                    // print the progress and the summary on the standard output
+    int shardIndex, shardCount;     // the fits of the list that this context runs, see dcSetShard
+    int noPruning, noCache;         // turn the abandoning of grid points and the lattice cache off, which change no fit, for the tests
+    /* the counters of the last fit, see dcGetCounters */
+    atomic_llong evaluations, abandoned, cacheLookups, cacheHits, cacheBytes;
+    PROFILE(dcProfile profile;)      // 20 KiB, so that the contexts and replicates of the other builds go without it
+};
+
+/* the number of threads and the optimizer for the legacy fitFunction interface; 0 threads means as many as there are online CPU cores */
+static atomic_int threadsNumber_g = 0;
+static atomic_int optimizer_g = DC_OPTIMIZER_LATTICE;
 
 /* The ten fitted functions */
 
-static char funcName0[] = "Erf-derived function";
+static const char funcName0[] = "Erf-derived function";
 static double erfLog(double x, int outcome, double b0, double b1, double b2, double b3, double b4, double b5, double b6, double b7){
     double result = internalLogL(x, b0, b1, b2, b3, b4, b5, b6, b7);
     if (result <= 0.0) return -DBL_MAX;
@@ -98,7 +152,7 @@ static double erfLog(double x, int outcome, double b0, double b1, double b2, dou
     return outcome ? logVerified(result) : logVerified(1.0 - result);
 }
 
-static char funcName1[] = "Erf-derived function with floor and ceiling";
+static const char funcName1[] = "Erf-derived function with floor and ceiling";
 static double erfLogFC(double x, int outcome, double b6, double b7, double b0, double b1, double b2, double b3, double b4, double b5){
     double result = internalLogS(x, b0, b1, b2, b3, b4, b5);
     if (result <= 0.0) return -DBL_MAX;
@@ -106,7 +160,7 @@ static double erfLogFC(double x, int outcome, double b6, double b7, double b0, d
     return outcome ? logVerified(result) : logVerified(1.0 - result);
 }
 
-static char funcName2[] = "Logistic-derived function";
+static const char funcName2[] = "Logistic-derived function";
 static double hyperbTan(double x, int outcome, double b0, double b1, double b2, double b3, double b4, double b5, double b6, double b7){
     double result = internalLogL(x, b0, b1, b2, b3, b4, b5, b6, b7);
     if (result <= 0.0) return -DBL_MAX;
@@ -114,7 +168,7 @@ static double hyperbTan(double x, int outcome, double b0, double b1, double b2,
     return outcome ? logVerified(result) : logVerified(1.0 - result);
 }
 
-static char funcName3[] = "Logistic-derived function with floor and ceiling";
+static const char funcName3[] = "Logistic-derived function with floor and ceiling";
 static double hyperbTanFC(double x, int outcome, double b6, double b7, double b0, double b1, double b2, double b3, double b4, double b5){
     double result = internalLogS(x, b0, b1, b2, b3, b4, b5);
     if (result <= 0.0) return -DBL_MAX;
@@ -122,7 +176,7 @@ static double hyperbTanFC(double x, int outcome, double b6, double b7, double b0
     return outcome ? logVerified(result) : logVerified(1.0 - result);
 }
 
-static char funcName4[] = "Gudermannian-derived function";
+static const char funcName4[] = "Gudermannian-derived function";
 static double GudFunc(double x, int outcome, double b0, double b1, double b2, double b3, double b4, double b5, double b6, double b7){
     double result = internalLogL(x, b0, b1, b2, b3, b4, b5, b6, b7);
     if (result <= 0.0) return -DBL_MAX;
@@ -130,7 +184,7 @@ static double GudFunc(double x, int outcome, double b0, double b1, double b2, do
     return outcome ? logVerified(result) : logVerified(1.0 - result);
 }
 
-static char funcName5[] = "Gudermannian-derived function with floor and ceiling";
+static const char funcName5[] = "Gudermannian-derived function with floor and ceiling";
 static double GudFuncFC(double x, int outcome, double b6, double b7, double b0, double b1, double b2, double b3, double b4, double b5){
     double result = internalLogS(x, b0, b1, b2, b3, b4, b5);
     if (result <= 0.0) return -DBL_MAX;
@@ -138,7 +192,7 @@ static double GudFuncFC(double x, int outcome, double b6, double b7, double b0,
     return outcome ? logVerified(result) : logVerified(1.0 - result);
 }
 
-static char funcName6[] = "Algebraic function derived from x over sqrt(1 + x^2)";
+static const char funcName6[] = "Algebraic function derived from x over sqrt(1 + x^2)";
 static double xOverX2(double x, int outcome, double b0, double b1, double b2, double b3, double b4, double b5, double b6, double b7){
     double result = internalLogL(x, b0, b1, b2, b3, b4, b5, b6, b7);
     if (result <= 0.0) return -DBL_MAX;
@@ -147,7 +201,7 @@ static double xOverX2(double x, int outcome, double b0, double b1, double b2, do
     return outcome ? logVerified(result) : logVerified(1.0 - result);
 }
 
-static char funcName7[] = "Algebraic function derived from x over sqrt(1 + x^2) with floor and ceiling";
+static const char funcName7[] = "Algebraic function derived from x over sqrt(1 + x^2) with floor and ceiling";
 static double xOverX2FC(double x, int outcome, double b6, double b7, double b0, double b1, double b2, double b3, double b4, double b5){
     double result = internalLogS(x, b0, b1, b2, b3, b4, b5);
     if (result <= 0.0) return -DBL_MAX;
@@ -156,7 +210,7 @@ static double xOverX2FC(double x, int outcome, double b6, double b7, double b0,
     return outcome ? logVerified(result) : logVerified(1.0 - result);
 }
 
-static char funcName8[] = "Algebraic function derived from x over (1 + abs(x))";
+static const char funcName8[] = "Algebraic function derived from x over (1 + abs(x))";
 static double xOverAbs(double x, int outcome, double b0, double b1, double b2, double b3, double b4, double b5, double b6, double b7){
     double result = internalLogL(x, b0, b1, b2, b3, b4, b5, b6, b7);
     if (result <= 0.0) return -DBL_MAX;
@@ -165,7 +219,7 @@ static double xOverAbs(double x, int outcome, double b0, double b1, double b2, d
     return outcome ? logVerified(result) : logVerified(1.0 - result);
 }
 
-static char funcName9[] = "Algebraic function derived from x over (1 + abs(x)) with floor and ceiling";
+static const char funcName9[] = "Algebraic function derived from x over (1 + abs(x)) with floor and ceiling";
 static double xOverAbsFC(double x, int outcome, double b6, double b7, double b0, double b1, double b2, double b3, double b4, double b5){
     double result = internalLogS(x, b0, b1, b2, b3, b4, b5);
     if (result <= 0.0) return -DBL_MAX;
@@ -175,124 +229,984 @@ static double xOverAbsFC(double x, int outcome, double b6, double b7, double b0,
 }
 
 /* array of function pointers to facilitate their calls by numbers */
-static double (*testFunc[TOTAL_NUMBER_OF_FUNCTIONS])(double x, int outcome, double b0, double b1, double b2, double b3, double b4, double b5, double b6, double b7);
+static double (* const testFunc[TOTAL_NUMBER_OF_FUNCTIONS])(double x, int outcome, double b0, double b1, double b2, double b3, double b4, double b5, double b6, double b7) = {
+    &erfLog, &erfLogFC, &hyperbTan, &hyperbTanFC, &GudFunc, &GudFuncFC, &xOverX2, &xOverX2FC, &xOverAbs, &xOverAbsFC };
+
+static const char * const funcNames[TOTAL_NUMBER_OF_FUNCTIONS] = {
+    funcName0, funcName1, funcName2, funcName3, funcName4, funcName5, funcName6, funcName7, funcName8, funcName9 };
+
+static int compareAges(const void * a, const void * b) {
+    double x = * (const double *) a;
+    double y = * (const double *) b;
+    return (x > y) - (x < y);
+}
+
+struct binOrder {
+    double magnitude, age;
+    int index;
+};
+
+/* the largest magnitude first, and the younger age first among equal magnitudes */
+static int compareBins(const void * a, const void * b) {
+    const struct binOrder * x = a;
+    const struct binOrder * y = b;
+    if (x->magnitude != y->magnitude) return (x->magnitude < y->magnitude) - (x->magnitude > y->magnitude);
+    return (x->age > y->age) - (x->age < y->age);
+}
+
+/* Each patient of the same age and outcome adds exactly the same term to the log-likelihood,
+so the rows are collapsed once per fit into (distinct age, deaths, survivors) bins, and the per-step cost
+depends on the number of distinct ages rather than on the size of the cohort */
+/* The pruned copy of the bins puts those adding the most to the log-likelihood first, which lets the kernels
+abandon a hopeless grid point after fewer bins. The term of each bin under the constant crude mortality rate
+serves as the estimate of its magnitude. The copy only serves the partial sums that abandon the points: the
+log-likelihood of a point that is not abandoned is summed over the bins in the order of the ages, so that the
+comparisons between the points, and hence the fit, are the same as without abandoning any */
+static int orderBins(struct binnedData * data) {
+    double totalDeaths = 0.0, total = 0.0;
+    for (int i = 0; i < data->bins; ++i) {
+        totalDeaths += data->deaths[i];
+        total += data->deaths[i] + data->survivors[i];
+    }
+    double rate = total > 0.0 ? totalDeaths / total : 0.5;
+    double logDeath = rate > 0.0 ? log(rate) : 0.0;
+    double logSurvival = rate < 1.0 ? log(1.0 - rate) : 0.0;
+    struct binOrder * order = malloc((data->bins + 1) * sizeof(struct binOrder));
+    data->prunedAge = malloc((data->binsPadded + 1) * sizeof(double));
+    data->prunedDeaths = calloc(data->binsPadded + 1, sizeof(double));
+    data->prunedSurvivors = calloc(data->binsPadded + 1, sizeof(double));
+    if (!order || !data->prunedAge || !data->prunedDeaths || !data->prunedSurvivors) {
+        free(order);
+        return -1;
+    }
+    for (int i = 0; i < data->bins; ++i) {
+        order[i].magnitude = -(data->deaths[i] * logDeath + data->survivors[i] * logSurvival);
+        order[i].age = data->age[i];
+        order[i].index = i;
+    }
+    qsort(order, data->bins, sizeof(struct binOrder), compareBins);
+    for (int i = 0; i < data->bins; ++i) {
+        data->prunedAge[i] = data->age[order[i].index];
+        data->prunedDeaths[i] = data->deaths[order[i].index];
+        data->prunedSurvivors[i] = data->survivors[order[i].index];
+    }
+    for (int i = data->bins; i < data->binsPadded; ++i)
+        data->prunedAge[i] = data->age[i];
+    free(order);
+    return 0;
+}
+
+static int compressData(struct binnedData * data, const double * ages, const int * the_outcomes, int length) {
+    double * sorted = malloc(length * sizeof(double));
+    data->age = malloc((length + SIMD_PADDING) * sizeof(double));
+    data->deaths = calloc(length + SIMD_PADDING, sizeof(double));
+    data->survivors = calloc(length + SIMD_PADDING, sizeof(double));
+    if (!sorted || !data->age || !data->deaths || !data->survivors) {
+        free(sorted);
+        return -1;
+    }
+    for (int i = 0; i < length; ++i)
+        sorted[i] = ages[i];
+    qsort(sorted, length, sizeof(double), compareAges);
+    data->bins = 0;
+    for (int i = 0; i < length; ++i)
+        if (!data->bins || sorted[i] != data->age[data->bins - 1])
+            data->age[data->bins++] = sorted[i];
+    free(sorted);
+    for (int i = 0; i < length; ++i) {
+        /* binary search of the bin, as the ages are already sorted and distinct */
+        int low = 0, high = data->bins - 1;
+        while (low < high) {
+            int middle = (low + high) / 2;
+            if (data->age[middle] < ages[i]) low = middle + 1;
+            else high = middle;
+        }
+        if (the_outcomes[i]) data->deaths[low] += 1.0;
+        else data->survivors[low] += 1.0;
+    }
+    /* the empty bins of the padding add nothing to the sum but keep the vector loops free of remainders (any valid age will do for them) */
+    data->binsPadded = (data->bins + SIMD_PADDING - 1) / SIMD_PADDING * SIMD_PADDING;
+    for (int i = data->bins; i < data->binsPadded; ++i)
+        data->age[i] = data->bins ? data->age[data->bins - 1] : 1.0;
+    if (orderBins(data) < 0) return -1;
+    return data->bins;
+}
+
+/* the second largest age of the cohort counting the repeated ages, which the Python wrapper ends its plots with */
+static double submaxAge(const struct binnedData * data) {
+    double largest = -DBL_MAX, second = -DBL_MAX, largestCases = 0.0;
+    for (int i = 0; i < data->bins; ++i) {
+        if (data->age[i] > largest) {
+            second = largest;
+            largest = data->age[i];
+            largestCases = data->deaths[i] + data->survivors[i];
+        } else if (data->age[i] > second)
+            second = data->age[i];
+    }
+    return largestCases > 1.0 || data->bins < 2 ? largest : second;
+}
+
+static void freeData(struct binnedData * data) {
+    free(data->age);
+    free(data->deaths);
+    free(data->survivors);
+    free(data->prunedAge);
+    free(data->prunedDeaths);
+    free(data->prunedSurvivors);
+}
+
+/* The batch kernels return the log-likelihood of all bins for one set of coefficients, which are
+passed in the same order as to the ten functions above: for the functions with the floor and
+ceiling, c[0] is the floor, c[1] is the ceiling and c[2]...c[7] are the polynomial coefficients.
+Each function is split into its internal polynomial, evaluated with Horner's scheme, and its
+sigmoid, which is scaled to the floor and ceiling for the odd functions. The ceiling and the floor
+are subtracted and added after the sigmoid one after another, as the ten functions do, since a
+probability close to 1 loses the rounding of their sum in the logarithm of its complement.
+Every term of the log-likelihood is non-positive, so the running sum can only decrease. Once it
+falls below the bound (the best point of the step found so far), the point cannot win the step,
+and the kernel returns the partial sum, which is still below the bound, and sets * abandoned.
+The partial sums run over the pruned copy of the bins (see orderBins), while a point that is not
+abandoned is summed again over the bins in the order of the ages, so that its log-likelihood does
+not depend on whether there was a bound. The bound is lowered by PRUNING_MARGIN of its magnitude,
+so that the rounding of the other order of summation cannot abandon a point that would win the step */
+static inline double scalarLink(int link, double poly) {
+    double temp = log(poly);
+    switch (link) {
+        case 0: return erf(temp);
+        case 1: return tanh(temp);
+        case 2: return atan(tanh(temp)) * M_1_PI * 4.0;
+        case 3: return temp * pow(1.0 + pow(temp, 2.0), -0.5);
+        default: return temp / (1 + fabs(temp));
+    }
+}
+
+static inline __attribute__((always_inline)) double batchSumScalar(const double * age, const double * deaths, const double * survivors, const int bins,
+                                                                   const int link, const int floorAndCeiling, const int degree, const double * c, double bound, int * abandoned) {
+    const double * coefficients = floorAndCeiling ? c + 2 : c;
+    double scale = floorAndCeiling ? 0.5 - c[1] : 0.5;
+    double sum = 0.0;
+    for (int block = 0; block < bins; block += PRUNING_BLOCK) {
+        int last = block + PRUNING_BLOCK < bins ? block + PRUNING_BLOCK : bins;
+        for (int i = block; i < last; ++i) {
+            double result = coefficients[degree];
+            for (int k = degree - 1; k >= 0; --k)
+                result = result * age[i] + coefficients[k];
+            if (result <= 0.0) {
+                sum += deaths[i] * -DBL_MAX + survivors[i] * -DBL_MAX;
+                continue;
+            }
+            result = scalarLink(link, result) * scale + 0.5;
+            if (floorAndCeiling) result = result - c[1] + c[0];
+            if (deaths[i] > 0.0)
+                sum += deaths[i] * logVerified(result);
+            if (survivors[i] > 0.0)
+                sum += survivors[i] * logVerified(1.0 - result);
+        }
+        if (last < bins && sum < bound) {
+            * abandoned = 1;
+            break;
+        }
+    }
+    return sum;
+}
+
+static inline double pruningBound(double bound) {
+    return bound - fabs(bound) * PRUNING_MARGIN;
+}
+
+static inline __attribute__((always_inline)) double batchBodyScalar(const struct binnedData * data, const int link, const int floorAndCeiling, const int degree, const double * c, double bound, int * abandoned) {
+    if (bound > -INFINITY) {
+        double partial = batchSumScalar(data->prunedAge, data->prunedDeaths, data->prunedSurvivors, data->bins, link, floorAndCeiling, degree, c, pruningBound(bound), abandoned);
+        if (* abandoned) return partial;
+    }
+    return batchSumScalar(data->age, data->deaths, data->survivors, data->bins, link, floorAndCeiling, degree, c, -INFINITY, abandoned);
+}
+
+/* The kernels are instantiated for each function and each polynomial order, so that the coefficients
+pinned at 10^-300 above the order are left out of the polynomial at compile time and the dispatch
+happens once per fitted function rather than once per row. For the functions with the floor and
+ceiling, the polynomial is two orders lower than polyn_order */
+#define POLYNOMIAL_ORDERS 6    // from 2 to 7
+#define KERNEL_DEGREE(func, order) ((func) % 2 ? (order) - 2 : (order))
+#define KERNELS_OF_FUNCTION(KERNEL, func) KERNEL(func, 2) KERNEL(func, 3) KERNEL(func, 4) KERNEL(func, 5) KERNEL(func, 6) KERNEL(func, 7)
+#define KERNELS_OF_ALL_FUNCTIONS(KERNEL) KERNELS_OF_FUNCTION(KERNEL, 0) KERNELS_OF_FUNCTION(KERNEL, 1) KERNELS_OF_FUNCTION(KERNEL, 2) KERNELS_OF_FUNCTION(KERNEL, 3) KERNELS_OF_FUNCTION(KERNEL, 4) \
+                                         KERNELS_OF_FUNCTION(KERNEL, 5) KERNELS_OF_FUNCTION(KERNEL, 6) KERNELS_OF_FUNCTION(KERNEL, 7) KERNELS_OF_FUNCTION(KERNEL, 8) KERNELS_OF_FUNCTION(KERNEL, 9)
+#define KERNEL_ROW(KERNEL, func) { KERNEL(func, 2), KERNEL(func, 3), KERNEL(func, 4), KERNEL(func, 5), KERNEL(func, 6), KERNEL(func, 7) }
+#define KERNEL_TABLE(KERNEL) { KERNEL_ROW(KERNEL, 0), KERNEL_ROW(KERNEL, 1), KERNEL_ROW(KERNEL, 2), KERNEL_ROW(KERNEL, 3), KERNEL_ROW(KERNEL, 4), \
+                               KERNEL_ROW(KERNEL, 5), KERNEL_ROW(KERNEL, 6), KERNEL_ROW(KERNEL, 7), KERNEL_ROW(KERNEL, 8), KERNEL_ROW(KERNEL, 9) }
+
+#define SCALAR_KERNEL(func, order) \
+    static double batchLogLScalar##func##_##order(const struct binnedData * data, const double * c, double bound, int * abandoned) { \
+        return batchBodyScalar(data, func / 2, func % 2, KERNEL_DEGREE(func, order), c, bound, abandoned); \
+    }
+KERNELS_OF_ALL_FUNCTIONS(SCALAR_KERNEL)
+#undef SCALAR_KERNEL
+
+#define SCALAR_KERNEL(func, order) batchLogLScalar##func##_##order
+static double (* const batchKernelsScalar[TOTAL_NUMBER_OF_FUNCTIONS][POLYNOMIAL_ORDERS])(const struct binnedData * data, const double * c, double bound, int * abandoned) = KERNEL_TABLE(SCALAR_KERNEL);
+#undef SCALAR_KERNEL
 
-static char * funcNames[TOTAL_NUMBER_OF_FUNCTIONS];
+/* The AVX2 and AVX-512 versions of the batch kernel, which are chosen at run time if the CPU supports them */
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && !defined(DEATHCURVE_NO_SIMD)
+#define SIMD_KERNELS 1
+#include <immintrin.h>
+#define SIMD_WIDTH 4
+#include "deathcurve_simd.h"
+#define SIMD_WIDTH 8
+#include "deathcurve_simd.h"
+#else
+#define SIMD_KERNELS 0
+#endif
 
-static void convertSigns(int func) {
+#if SIMD_KERNELS
+/* the widest instruction set the CPU supports, detected once per process: 0 is scalar, 1 is AVX2, 2 is AVX-512 */
+static int simdLevel_g;
+static pthread_once_t simdOnce_g = PTHREAD_ONCE_INIT;
+
+static void detectSimd(void) {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        simdLevel_g = 2;
+    else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        simdLevel_g = 1;
+}
+#endif
+
+/* returns the kernel for the function and polynomial order with the widest instruction set the CPU supports */
+static double (*kernelFor(int func, int polyn_order))(const struct binnedData * data, const double * c, double bound, int * abandoned) {
+#if SIMD_KERNELS
+    pthread_once(&simdOnce_g, detectSimd);
+    if (simdLevel_g == 2)
+        return batchKernelsAvx512[func][polyn_order - 2];
+    if (simdLevel_g == 1)
+        return batchKernelsAvx2[func][polyn_order - 2];
+#endif
+    return batchKernelsScalar[func][polyn_order - 2];
+}
+
+/* The derivative of the sigmoids of scalarLink with respect to the logarithm of the polynomial */
+static inline double scalarLinkDerivative(int link, double temp) {
+    double th;
+    switch (link) {
+        case 0: return M_2_SQRTPI * exp(-temp * temp);
+        case 1:
+            th = tanh(temp);
+            return 1.0 - th * th;
+        case 2:
+            th = tanh(temp);
+            return (1.0 - th * th) / (1.0 + th * th) * M_1_PI * 4.0;
+        case 3: return pow(1.0 + temp * temp, -1.5);
+        default: return 1.0 / ((1.0 + fabs(temp)) * (1.0 + fabs(temp)));
+    }
+}
+
+/* Returns the log-likelihood of all bins and its gradient with respect to the coefficients c, which are in
+the order of the kernels, or -INFINITY if any bin gets a probability outside the range that logVerified accepts.
+With the link h, every function is p = A * h(log P) + B for the internal polynomial P, where A = B = 0.5
+without the floor and ceiling and A = 0.5 - c[1], B = 0.5 - c[1] + c[0] with them */
+static double gradientLogL(const struct binnedData * data, int func, int polyn_order, const double * c, double * gradient) {
+    int link = func / 2;
+    int floorAndCeiling = func % 2;
+    int degree = KERNEL_DEGREE(func, polyn_order);
+    const double * coefficients = floorAndCeiling ? c + 2 : c;
+    double * polynomialGradient = floorAndCeiling ? gradient + 2 : gradient;
+    double scale = floorAndCeiling ? 0.5 - c[1] : 0.5;
+    double sum = 0.0;
+    for (int k = 0; k < 8; ++k)
+        gradient[k] = 0.0;
+    for (int i = 0; i < data->bins; ++i) {
+        double x = data->age[i];
+        double deaths = data->deaths[i];
+        double survivors = data->survivors[i];
+        double poly = coefficients[degree];
+        for (int k = degree - 1; k >= 0; --k)
+            poly = poly * x + coefficients[k];
+        if (poly <= 0.0) return -INFINITY;
+        double temp = log(poly);
+        double h = scalarLink(link, poly);
+        double p = h * scale + 0.5;
+        if (floorAndCeiling) p = p - c[1] + c[0];
+        if ((deaths > 0.0 && (p <= 0.0 || p > 1.0)) || (survivors > 0.0 && (p < 0.0 || p >= 1.0))) return -INFINITY;
+        if (deaths > 0.0) sum += deaths * log(p);
+        if (survivors > 0.0) sum += survivors * log(1.0 - p);
+        /* the derivative of the log-likelihood of the bin with respect to p */
+        double weight = (deaths > 0.0 ? deaths / p : 0.0) - (survivors > 0.0 ? survivors / (1.0 - p) : 0.0);
+        double common = weight * scale * scalarLinkDerivative(link, temp) / poly;
+        double power = 1.0;
+        for (int k = 0; k <= degree; ++k) {
+            polynomialGradient[k] += common * power;
+            power *= x;
+        }
+        if (floorAndCeiling) {
+            gradient[0] += weight;
+            gradient[1] -= weight * (h + 1.0);
+        }
+    }
+    return sum;
+}
+
+/* The log-likelihoods of the lattice points that a fit has already evaluated at its current precision.
+Consecutive steps overlap heavily because the new center is one of the points of the previous step.
+The points are keyed by their integer coordinates: the powers of the coefficients in units of the
+precision relative to the origin of the lattice (see struct fitTask). Only the thread that runs the
+fit looks up and inserts points, before and after the pool evaluates the rest of a step */
+enum { CACHE_EMPTY, CACHE_EXACT, CACHE_BOUND };     // CACHE_BOUND: the point was abandoned, and its value is an upper bound
+
+struct cacheEntry {
+    int32_t key[8];
+    double value;
+    int state;
+};
+
+struct latticeCache {
+    struct cacheEntry * entries;
+    size_t capacity, used;          // the capacity is a power of two
+    long long lookups, hits;
+    size_t peakBytes;
+};
+
+static uint64_t hashKey(const int32_t * key) {
+    uint64_t hash = 0x9E3779B97F4A7C15ULL;
+    for (int i = 0; i < 8; ++i) {
+        hash = (hash ^ (uint32_t) key[i]) * 0xBF58476D1CE4E5B9ULL;
+        hash ^= hash >> 31;
+    }
+    return hash;
+}
+
+/* returns the entry of the key or the empty entry where it belongs */
+static struct cacheEntry * cacheSlot(struct latticeCache * cache, const int32_t * key) {
+    size_t mask = cache->capacity - 1;
+    for (size_t i = hashKey(key) & mask; ; i = (i + 1) & mask) {
+        struct cacheEntry * entry = &cache->entries[i];
+        if (entry->state == CACHE_EMPTY) return entry;
+        int same = 1;
+        for (int j = 0; j < 8; ++j)
+            same &= entry->key[j] == key[j];
+        if (same) return entry;
+    }
+}
+
+static void cacheInsert(struct latticeCache * cache, const int32_t * key, double value, int state) {
+    if ((cache->used + 1) * 2 > cache->capacity) {
+        struct cacheEntry * old = cache->entries;
+        size_t oldCapacity = cache->capacity;
+        struct cacheEntry * entries = calloc(oldCapacity * 2, sizeof(struct cacheEntry));
+        if (!entries) return;   // the cache is only an optimization, so it just stops growing
+        cache->entries = entries;
+        cache->capacity = oldCapacity * 2;
+        for (size_t i = 0; i < oldCapacity; ++i)
+            if (old[i].state != CACHE_EMPTY)
+                * cacheSlot(cache, old[i].key) = old[i];
+        free(old);
+        if (cache->capacity * sizeof(struct cacheEntry) > cache->peakBytes)
+            cache->peakBytes = cache->capacity * sizeof(struct cacheEntry);
+    }
+    struct cacheEntry * entry = cacheSlot(cache, key);
+    if (entry->state == CACHE_EMPTY) ++cache->used;
+    for (int j = 0; j < 8; ++j)
+        entry->key[j] = key[j];
+    entry->value = value;
+    entry->state = state;
+}
+
+static void cacheClear(struct latticeCache * cache) {
+    memset(cache->entries, 0, cache->capacity * sizeof(struct cacheEntry));
+    cache->used = 0;
+}
+
+/* One fit of one function with one set of signs of the coefficients. This is the unit of work that the
+worker pool schedules, and all the state of its hill climbing lives here so that many fits may run at once */
+struct fitTask {
+    const struct dcContext * ctx;
+    struct cohortFits * cohort;     // the fits of the same context in the same call
+    int func;
+    unsigned char signs;
+    char signString[9];
+    char tag[32];                   // prefixes the progress messages when several fits run at once
+    double s[8];                    // the signs of the coefficients in the order the function receives them
+    double (*kernel)(const struct binnedData * data, const double * c, double bound, int * abandoned);
+    /* the powers of the coefficients in the center of the current step are origin + lattice * 10^-precision,
+    so that a lattice point gives exactly the same coefficients from whichever center it is reached */
+    double origin[8];
+    int32_t lattice[8];
+    int precision;
+    double candidates[8][3];        // the three values with their signs of each coefficient on the grid of the current step
+    double * result;                // the log-likelihood of each grid point of the current step
+    unsigned char * abandonedPoint; // the grid points of the current step that were abandoned early
+    int * pending;                  // the grid points of the current step that are not in the cache
+    struct latticeCache cache;
+    _Atomic double best;            // the best log-likelihood of the current step found so far by any thread
+    atomic_llong evaluations, abandoned;
+    int started;
+    int failed;                     // the memory of the steps could not be allocated, so the fit was not made
+    double output[9];               // the fitted coefficients with their signs and the ML estimate
+#ifdef DEATHCURVE_PROFILE
+    long long steps[5], backoffs, lbfgsIterations;
+    double seconds;
+    atomic_llong computeNanoseconds;
+#endif
+};
+
+static void signsToString(unsigned char signs, char * signString) {
     for (int i=0; i < 8; ++i)
         signString[i] = (signs & (unsigned char) pow(2, i)) ? '-' : '+';
-    if (func % 2) {
-        s6_g = (signs & (unsigned char) 0b00000001) ? -1.0 : 1.0;
-        s7_g = (signs & (unsigned char) 0b00000010) ? -1.0 : 1.0;
-        s0_g = (signs & (unsigned char) 0b00000100) ? -1.0 : 1.0;
-        s1_g = (signs & (unsigned char) 0b00001000) ? -1.0 : 1.0;
-        s2_g = (signs & (unsigned char) 0b00010000) ? -1.0 : 1.0;
-        s3_g = (signs & (unsigned char) 0b00100000) ? -1.0 : 1.0;
-        s4_g = (signs & (unsigned char) 0b01000000) ? -1.0 : 1.0;
-        s5_g = (signs & (unsigned char) 0b10000000) ? -1.0 : 1.0;
+    signString[8] = '\0';
+}
+
+static void convertSigns(struct fitTask * task) {
+    unsigned char signs = task->signs;
+    signsToString(signs, task->signString);
+    if (task->func % 2) {
+        task->s[6] = (signs & (unsigned char) 0b00000001) ? -1.0 : 1.0;
+        task->s[7] = (signs & (unsigned char) 0b00000010) ? -1.0 : 1.0;
+        task->s[0] = (signs & (unsigned char) 0b00000100) ? -1.0 : 1.0;
+        task->s[1] = (signs & (unsigned char) 0b00001000) ? -1.0 : 1.0;
+        task->s[2] = (signs & (unsigned char) 0b00010000) ? -1.0 : 1.0;
+        task->s[3] = (signs & (unsigned char) 0b00100000) ? -1.0 : 1.0;
+        task->s[4] = (signs & (unsigned char) 0b01000000) ? -1.0 : 1.0;
+        task->s[5] = (signs & (unsigned char) 0b10000000) ? -1.0 : 1.0;
     } else {
-        s0_g = (signs & (unsigned char) 0b00000001) ? -1.0 : 1.0;
-        s1_g = (signs & (unsigned char) 0b00000010) ? -1.0 : 1.0;
-        s2_g = (signs & (unsigned char) 0b00000100) ? -1.0 : 1.0;
-        s3_g = (signs & (unsigned char) 0b00001000) ? -1.0 : 1.0;
-        s4_g = (signs & (unsigned char) 0b00010000) ? -1.0 : 1.0;
-        s5_g = (signs & (unsigned char) 0b00100000) ? -1.0 : 1.0;
-        s6_g = (signs & (unsigned char) 0b01000000) ? -1.0 : 1.0;
-        s7_g = (signs & (unsigned char) 0b10000000) ? -1.0 : 1.0;
-    }
-}
-
-static void * getML(void * threadId) {
-    result_g[(int)threadId] = 0.0;
-    double precision_l = pow(10.0, -precision_g);
-    double b0_l = s0_g * pow(10.0, b0_g + ((int)threadId / 2187 - 1) * precision_l);
-    double b1_l = s1_g * pow(10.0, b1_g + ((int)threadId % 2187 / 729 - 1) * precision_l);
-    double b2_l = s2_g * pow(10.0, b2_g + ((int)threadId % 729 / 243 - 1) * precision_l);
-    double b3_l = s3_g * pow(10.0, b3_g + ((int)threadId % 243 / 81 - 1) * precision_l);
-    double b4_l = s4_g * pow(10.0, b4_g + ((int)threadId % 81 / 27 - 1) * precision_l);
-    double b5_l = s5_g * pow(10.0, b5_g + ((int)threadId % 27 / 9 - 1) * precision_l);
-    double b6_l = s6_g * pow(10.0, b6_g + ((int)threadId % 9 / 3 - 1) * precision_l);
-    double b7_l = s7_g * pow(10.0, b7_g + ((int)threadId % 3 - 1) * precision_l);
-    for (int i = 0; i < length_g; ++i)
-        result_g[(int)threadId] += testFunc[func_g](age_g[i], outcome_g[i], b0_l, b1_l , b2_l, b3_l, b4_l, b5_l, b6_l, b7_l);
-    return (void *) (intptr_t) 0;
-}
-
-static int oneStep(int func, double * result, double * age, int * outcome, int length, double b0, double b1, double b2, double b3, double b4, double b5, double b6, double b7, int precision) {
-    func_g = func;    outcome_g = outcome;    length_g = length;    precision_g = precision;
-    b0_g = b0;    b1_g = b1;    b2_g = b2;    b3_g = b3;    b4_g = b4;    b5_g = b5;    b6_g = b6;    b7_g = b7;    age_g = age;
-    /* "_g" on the end of the variable's name attempts to remind the coder that the variable is global */
-    pthread_attr_t attr;
-    size_t stacksize = 16384;    // limited due to a huge number of generated threads to potentially preserve RAM
-    pthread_attr_init(&attr);
-    pthread_attr_setstacksize(&attr, stacksize);
-    pthread_t * myThreads;
-    result_g = malloc(pow(3,8) * sizeof(double));
-    myThreads = malloc(pow(3,8) * sizeof(pthread_t));
-    int threadCount=0;
-    for (threadCount = start_g; threadCount < THREADS_MAX; threadCount += skip_g)
-        pthread_create(&myThreads[threadCount], NULL, getML, (void *) (intptr_t) threadCount);
-    for (int i = start_g; i < threadCount; i += skip_g)
-        pthread_join(myThreads[i], NULL);
-    * result = result_g[start_g + skip_g];
-    int position = start_g + skip_g;
+        task->s[0] = (signs & (unsigned char) 0b00000001) ? -1.0 : 1.0;
+        task->s[1] = (signs & (unsigned char) 0b00000010) ? -1.0 : 1.0;
+        task->s[2] = (signs & (unsigned char) 0b00000100) ? -1.0 : 1.0;
+        task->s[3] = (signs & (unsigned char) 0b00001000) ? -1.0 : 1.0;
+        task->s[4] = (signs & (unsigned char) 0b00010000) ? -1.0 : 1.0;
+        task->s[5] = (signs & (unsigned char) 0b00100000) ? -1.0 : 1.0;
+        task->s[6] = (signs & (unsigned char) 0b01000000) ? -1.0 : 1.0;
+        task->s[7] = (signs & (unsigned char) 0b10000000) ? -1.0 : 1.0;
+    }
+}
+
+/* the integer coordinates of a grid point of the current step */
+static void latticeKey(const struct fitTask * task, int index, int32_t * key) {
+    key[0] = task->lattice[0] + index / 2187 - 1;
+    key[1] = task->lattice[1] + index % 2187 / 729 - 1;
+    key[2] = task->lattice[2] + index % 729 / 243 - 1;
+    key[3] = task->lattice[3] + index % 243 / 81 - 1;
+    key[4] = task->lattice[4] + index % 81 / 27 - 1;
+    key[5] = task->lattice[5] + index % 27 / 9 - 1;
+    key[6] = task->lattice[6] + index % 9 / 3 - 1;
+    key[7] = task->lattice[7] + index % 3 - 1;
+}
+
+/* moves the origin of the lattice to the current center and starts a new cache when the precision changes */
+static void setPrecision(struct fitTask * task, int precision) {
+    if (precision == task->precision) return;
+    for (int i = 0; i < 8; ++i) {
+        task->origin[i] += task->lattice[i] * pow(10.0, -task->precision);
+        task->lattice[i] = 0;
+    }
+    task->precision = precision;
+    cacheClear(&task->cache);
+}
+
+/* Each coefficient takes one of three values on the grid of a step, so the 24 powers of ten are computed once per step
+rather than eight for each of the 6561 grid points, and a grid point only picks its coefficients from the table. The
+values are computed exactly as from the lattice key of the point, so the fits are the same to the last bit */
+static void setCandidates(struct fitTask * task) {
+    double precision_l = pow(10.0, -task->precision);
+    for (int i = 0; i < 8; ++i)
+        for (int j = 0; j < 3; ++j)
+            task->candidates[i][j] = task->s[i] * pow(10.0, task->origin[i] + (task->lattice[i] + j - 1) * precision_l);
+}
+
+/* returns 1 if the grid point was abandoned early */
+static int getML(struct fitTask * task, int index) {
+    double coefficients[8] = { task->candidates[0][index / 2187], task->candidates[1][index % 2187 / 729],
+                               task->candidates[2][index % 729 / 243], task->candidates[3][index % 243 / 81],
+                               task->candidates[4][index % 81 / 27], task->candidates[5][index % 27 / 9],
+                               task->candidates[6][index % 9 / 3], task->candidates[7][index % 3] };
+    double bound = task->ctx->noPruning ? -INFINITY : atomic_load_explicit(&task->best, memory_order_relaxed);
+    int abandoned = 0;
+    double result = task->kernel(&task->ctx->data, coefficients, bound, &abandoned);
+    task->result[index] = result;
+    /* the abandoned points are below the bound, so they never raise it */
+    while (result > bound && !atomic_compare_exchange_weak_explicit(&task->best, &bound, result, memory_order_relaxed, memory_order_relaxed));
+    return abandoned;
+}
+
+static double monotonicSeconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/* The grid points of one step of one fit, split into chunks that any thread of the pool may claim */
+struct stepJob {
+    struct fitTask * task;
+    int points, chunks, chunkSize;
+    atomic_int nextChunk, pendingChunks;
+    int users;                      // the threads holding a pointer to this job, guarded by the pool mutex
+    int listed;
+    struct stepJob * next;
+};
+
+/* A checkpoint is this header followed by one record per fit of a function with a set of signs, in the order of the
+list of the fits, all in the byte order of the machine that wrote it. A fit that is running is recorded as it was
+after its latest step, which is all the hill climbing needs to go on exactly as if it had not been interrupted */
+enum taskStatus {TASK_PENDING, TASK_RUNNING, TASK_DONE};
+
+struct checkpointHeader {
+    char magic[8];                  // "DCCKPT" followed by two zero bytes
+    int32_t version;
+    int32_t polynOrder, optimizer, sign1, sign2;
+    int32_t functionsToTest[TOTAL_NUMBER_OF_FUNCTIONS];
+    int32_t bins, tasksNumber;
+    int32_t shardIndex, shardCount; // the checkpoint holds the fits of the list whose positions modulo shardCount are shardIndex
+    int32_t reserved;
+    uint64_t dataHash;              // tells a cohort from another one with as many distinct ages
+    double submaxAge;               // the second largest age of the cohort, which ends the plots of the merged shards
+};
+
+struct checkpointRecord {
+    int32_t func, signs, status;
+    int32_t precision, repeats, repeatsWarning, position;
+    int32_t lattice[8];
+    int32_t reserved;
+    double result, resultPrev;
+    double origin[8];
+    double output[9];               // the fitted coefficients with their signs and the ML estimate of a finished fit
+};
+
+_Static_assert(sizeof(struct checkpointHeader) == 104 && sizeof(struct checkpointRecord) == 216, "the checkpoint layout must not depend on the compiler");
+
+/* The fits of the functions with their signs of one context in one call of dcFit, dcResume, or dcFitBatch. Each context
+keeps its own checkpoint, progress reports, and stop signals, even when the pool runs the fits of other contexts as well */
+struct cohortFits {
+    dcContext * ctx;
+    int index;                      // of the context in dcFitBatch, or -1 for dcFit and dcResume
+    char tag[20];                   // prefixes the messages of the fits of a context of dcFitBatch
+    struct fitTask * tasks;
+    int tasksNumber;
+    /* guarded by the pool mutex */
+    struct checkpointRecord * records;  // the state of each fit as of its latest step
+    int writingCheckpoint, reporting;
+    double lastCheckpoint, lastReport;
+    long long lastReportEvaluations;
+    atomic_int cancelled;
+    struct checkpointHeader header;
+    PROFILE(double started;)
+};
+
+/* The worker pool is created once per fitFunction call. Its threads run the fits (function and signs)
+from a shared queue, up to maxRunningTasks of them at once, and each fit posts the grid points of its
+steps as chunks. A thread that has nothing else to do takes chunks from whichever step is posted,
+so the cores are shared between the running fits without being tied to any of them */
+struct workerPool {
+    pthread_t * threads;
+    int workers;                    // the calling thread works as well, so there is one fewer worker than threads
+    int share;                      // how many threads one step can keep busy
+    pthread_mutex_t mutex;
+    pthread_cond_t wake, done;
+    /* guarded by the mutex */
+    struct stepJob * jobs;          // the steps that still have chunks to claim
+    struct fitTask ** queue;        // the fits of all the contexts in the order they are started
+    int queueLength, nextTask, runningTasks, maxRunningTasks, stop;
+    PROFILE(double spawnSeconds, joinSeconds;)
+};
+
+static void runChunks(struct workerPool * pool, struct stepJob * job, int limit) {
+    int chunk, claimed = 0;
+    while ((!limit || claimed++ < limit) && (chunk = atomic_fetch_add(&job->nextChunk, 1)) < job->chunks) {
+        int last = (chunk + 1) * job->chunkSize < job->points ? (chunk + 1) * job->chunkSize : job->points;
+        int evaluations = 0, abandoned = 0;
+        PROFILE(double started = monotonicSeconds();)
+        for (int i = chunk * job->chunkSize; i < last; ++i) {
+            int index = job->task->pending[i];
+            abandoned += job->task->abandonedPoint[index] = getML(job->task, index);
+            ++evaluations;
+        }
+        PROFILE(atomic_fetch_add_explicit(&job->task->computeNanoseconds, (long long) ((monotonicSeconds() - started) * 1e9), memory_order_relaxed);)
+        atomic_fetch_add_explicit(&job->task->evaluations, evaluations, memory_order_relaxed);
+        atomic_fetch_add_explicit(&job->task->abandoned, abandoned, memory_order_relaxed);
+        if (atomic_fetch_sub(&job->pendingChunks, 1) == 1) {
+            pthread_mutex_lock(&pool->mutex);
+            pthread_cond_broadcast(&pool->done);
+            pthread_mutex_unlock(&pool->mutex);
+        }
+    }
+}
+
+/* called with the mutex locked by a thread that has finished claiming chunks of the job */
+static void releaseJob(struct workerPool * pool, struct stepJob * job) {
+    if (job->listed && atomic_load(&job->nextChunk) >= job->chunks) {
+        struct stepJob ** link = &pool->jobs;
+        while (* link != job) link = &(* link)->next;
+        * link = job->next;
+        job->listed = 0;
+    }
+    if (!--job->users)
+        pthread_cond_broadcast(&pool->done);
+}
+
+/* takes the log-likelihood of the grid point from the cache if it is there and can still matter for this step */
+static int cacheLookup(struct fitTask * task, int index) {
+    if (task->ctx->noCache) return 0;
+    int32_t key[8];
+    latticeKey(task, index, key);
+    struct cacheEntry * entry = cacheSlot(&task->cache, key);
+    ++task->cache.lookups;
+    /* an abandoned point only needs to stay below the best point of the step, as it did in the step that abandoned it */
+    if (entry->state == CACHE_EXACT || (entry->state == CACHE_BOUND && entry->value < atomic_load_explicit(&task->best, memory_order_relaxed))) {
+        task->result[index] = entry->value;
+        ++task->cache.hits;
+        return 1;
+    }
+    return 0;
+}
+
+static void cacheStore(struct fitTask * task, int index) {
+    if (task->ctx->noCache) return;
+    int32_t key[8];
+    latticeKey(task, index, key);
+    cacheInsert(&task->cache, key, task->result[index], task->abandonedPoint[index] ? CACHE_BOUND : CACHE_EXACT);
+}
+
+/* evaluates the grid points start, start + skip, ... of the current step of the task with the help of the idle threads */
+static void runStep(struct workerPool * pool, struct fitTask * task) {
+    const struct dcContext * ctx = task->ctx;
+    /* the center of the grid, where the previous step ended, is likely among the best points of this one,
+    so it is taken first to give the other points a bound to be abandoned at */
+    atomic_store_explicit(&task->best, -INFINITY, memory_order_relaxed);
+    setCandidates(task);
+    if (!cacheLookup(task, GRID_CENTER)) {
+        task->abandonedPoint[GRID_CENTER] = getML(task, GRID_CENTER);
+        atomic_fetch_add_explicit(&task->evaluations, 1, memory_order_relaxed);
+        cacheStore(task, GRID_CENTER);
+    }
+    atomic_store_explicit(&task->best, task->result[GRID_CENTER], memory_order_relaxed);
+    int points = 0;
+    for (int index = ctx->start; index < GRID_SIZE; index += ctx->skip)
+        if (index != GRID_CENTER && !cacheLookup(task, index))
+            task->pending[points++] = index;
+    if (!points) return;
+    struct stepJob job;
+    job.task = task;
+    job.points = points;
+    job.chunkSize = (points + pool->share * CHUNKS_PER_THREAD - 1) / (pool->share * CHUNKS_PER_THREAD);
+    job.chunks = (points + job.chunkSize - 1) / job.chunkSize;
+    atomic_init(&job.nextChunk, 0);
+    atomic_init(&job.pendingChunks, job.chunks);
+    job.users = 1;
+    job.listed = 0;
+    job.next = NULL;
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->workers && job.chunks > 1) {
+        struct stepJob ** link = &pool->jobs;
+        while (* link) link = &(* link)->next;
+        * link = &job;
+        job.listed = 1;
+        pthread_cond_broadcast(&pool->wake);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    runChunks(pool, &job, 0);
+    pthread_mutex_lock(&pool->mutex);
+    releaseJob(pool, &job);
+    /* while the last chunks are finished by other threads, help the other steps one chunk at a time */
+    while (atomic_load(&job.pendingChunks) || job.users) {
+        struct stepJob * other = pool->jobs;
+        if (other) {
+            ++other->users;
+            pthread_mutex_unlock(&pool->mutex);
+            runChunks(pool, other, 1);
+            pthread_mutex_lock(&pool->mutex);
+            releaseJob(pool, other);
+        } else
+            pthread_cond_wait(&pool->done, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    for (int i = 0; i < points; ++i)
+        cacheStore(task, task->pending[i]);
+}
+
+/* The abandoned grid points hold partial sums below the best point of the step, and the choice below
+depends only on the points that reach the maximum, so it is the same as if all points were evaluated */
+static int oneStep(struct workerPool * pool, struct fitTask * task, double * result) {
+    const struct dcContext * ctx = task->ctx;
+    double * result_l = task->result;
+    runStep(pool, task);
+    * result = result_l[ctx->start + ctx->skip];
+    int position = ctx->start + ctx->skip;
     int condition = 1;
     while(condition) {
         condition = 0;
-        for (int iOrder = order_g; iOrder <= 8; ++iOrder) {
-            if (result_g[indexConverter(iOrder)] >= *result) {
-                * result = result_g[indexConverter(iOrder)];
+        for (int iOrder = ctx->order; iOrder <= 8; ++iOrder) {
+            if (result_l[indexConverter(iOrder)] >= *result) {
+                * result = result_l[indexConverter(iOrder)];
                 position = indexConverter(iOrder);
             }
         }
-        for (int i = start_g; i < THREADS_MAX; i += skip_g) {
-            if (result_g[i] > *result) {
-                * result = result_g[i];
+        for (int i = ctx->start; i < GRID_SIZE; i += ctx->skip) {
+            if (result_l[i] > *result) {
+                * result = result_l[i];
                 position = i;
                 condition = 1;
             }
         }
     }
-    free(myThreads);
-    free(result_g);
     return position;
 }
 
-/* the function that needs to be called from the Python (wrapper) script */
-int fitFunction(double * ages, int * the_outcomes, int length, double * output, int * sign1, int sign2, int * functionsToTest, int polyn_order) {
-    order_g = 8 - polyn_order;
-    start_g = ((int) pow(3, 7 - polyn_order)) / 2;
-    skip_g = (int) pow(3, 7 - polyn_order);
+/* prints on the standard output unless the console is turned off for the context */
+static void message(const dcContext * ctx, const char * format, ...) {
+    if (!ctx->console) return;
+    va_list arguments;
+    va_start(arguments, format);
+    vprintf(format, arguments);
+    va_end(arguments);
+    fflush(stdout);
+}
+
+/* checks the stop signal, which is shared by all the fits of the context; only the stop signal file costs a system call */
+static int stopSignal(struct cohortFits * cohort) {
     FILE * fp;   // file pointer for the stop signal
-    signString[8] = '\0';
-    testFunc[0] = &erfLog;
-    testFunc[1] = &erfLogFC;
-    testFunc[2] = &hyperbTan;
-    testFunc[3] = &hyperbTanFC;
-    testFunc[4] = &GudFunc;
-    testFunc[5] = &GudFuncFC;
-    testFunc[6] = &xOverX2;
-    testFunc[7] = &xOverX2FC;
-    testFunc[8] = &xOverAbs;
-    testFunc[9] = &xOverAbsFC;
-    funcNames[0] = funcName0;
-    funcNames[1] = funcName1;
-    funcNames[2] = funcName2;
-    funcNames[3] = funcName3;
-    funcNames[4] = funcName4;
-    funcNames[5] = funcName5;
-    funcNames[6] = funcName6;
-    funcNames[7] = funcName7;
-    funcNames[8] = funcName8;
-    funcNames[9] = funcName9;
-    double finalResults[STOP_FUNCTION][9];
-    for (int i = 0; i < STOP_FUNCTION; ++i)
-        finalResults[i][8] = -1e100;
-    unsigned char finalSigns[STOP_FUNCTION];
-    double result = 0.0;
-    double resultPrev = 0.0;
-    int position = 0;
+    const dcContext * ctx = cohort->ctx;
+    if (atomic_load(&cohort->cancelled)) return 1;
+    if (ctx->cancelFlag && atomic_load_explicit(ctx->cancelFlag, memory_order_relaxed)) {
+        atomic_store(&cohort->cancelled, 1);
+        return 1;
+    }
+    if (ctx->stopFile && (fp = fopen(ctx->stopFile, "r")) != NULL) {
+        fclose(fp);
+        atomic_store(&cohort->cancelled, 1);
+        return 1;
+    }
+    return 0;
+}
+
+/* FNV-1a of the bins */
+static uint64_t hashData(const struct binnedData * data) {
+    uint64_t hash = 14695981039346656037ULL;
+    const double * columns[3] = {data->age, data->deaths, data->survivors};
+    for (int column = 0; column < 3; ++column) {
+        const unsigned char * bytes = (const unsigned char *) columns[column];
+        for (size_t i = 0; i < data->bins * sizeof(double); ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+/* writes a temporary file next to the checkpoint and renames it over the checkpoint, so that an interrupted write
+leaves the previous checkpoint intact; returns -1 if the checkpoint could not be written */
+static int writeCheckpoint(const char * path, const struct checkpointHeader * header, const struct checkpointRecord * records) {
+    size_t length = strlen(path);
+    char * temporary = malloc(length + 5);
+    if (!temporary) return -1;
+    memcpy(temporary, path, length);
+    memcpy(temporary + length, ".tmp", 5);
+    FILE * fp = fopen(temporary, "wb");
+    int failed = !fp;
+    if (fp) {
+        failed |= fwrite(header, sizeof(*header), 1, fp) != 1;
+        failed |= fwrite(records, sizeof(*records), header->tasksNumber, fp) != (size_t) header->tasksNumber;
+        failed |= fflush(fp) != 0;
+        failed |= fsync(fileno(fp)) != 0;
+        failed |= fclose(fp) != 0;
+    }
+    if (!failed) failed = rename(temporary, path) != 0;
+    else if (fp) remove(temporary);
+    free(temporary);
+    return failed ? -1 : 0;
+}
+
+/* reads a whole checkpoint; returns -1 if the file cannot be read or is not a checkpoint of this version */
+static int readCheckpoint(const char * path, struct checkpointHeader * header, struct checkpointRecord ** records) {
+    FILE * fp = fopen(path, "rb");
+    if (!fp) return -1;
+    *records = NULL;
+    int failed = fread(header, sizeof(*header), 1, fp) != 1
+              || memcmp(header->magic, "DCCKPT\0\0", 8)
+              || header->version != CHECKPOINT_VERSION
+              || header->tasksNumber < 0 || header->tasksNumber > TOTAL_NUMBER_OF_FUNCTIONS * MAX_SIGN_PATTERNS;
+    if (!failed) {
+        *records = malloc((header->tasksNumber + 1) * sizeof(struct checkpointRecord));
+        failed = !*records || fread(*records, sizeof(struct checkpointRecord), header->tasksNumber, fp) != (size_t) header->tasksNumber;
+    }
+    fclose(fp);
+    if (failed) {
+        free(*records);
+        *records = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/* publishes the state of a fit after a step and, if the checkpoint or the progress report is due, writes the checkpoint
+with the states of all the fits or calls back with the progress; whichever thread finds them due does it while the others go on */
+static void saveProgress(struct workerPool * pool, struct fitTask * task, const struct checkpointRecord * state) {
+    const dcContext * ctx = task->ctx;
+    struct cohortFits * cohort = task->cohort;
+    struct checkpointRecord * records = NULL;
+    int reporting = 0;
+    double now = 0.0;
+    dcProgress progress;
+    pthread_mutex_lock(&pool->mutex);
+    cohort->records[task - cohort->tasks] = *state;
+    if (ctx->checkpointPath || ctx->progress)
+        now = monotonicSeconds();
+    if (ctx->checkpointPath && !cohort->writingCheckpoint && now - cohort->lastCheckpoint >= ctx->checkpointInterval
+        && (records = malloc(cohort->tasksNumber * sizeof(struct checkpointRecord)))) {
+        memcpy(records, cohort->records, cohort->tasksNumber * sizeof(struct checkpointRecord));
+        cohort->writingCheckpoint = 1;
+    }
+    if (ctx->progress && !cohort->reporting && now - cohort->lastReport >= ctx->progressInterval) {
+        cohort->reporting = reporting = 1;
+        progress.function = task->func;
+        progress.signs = task->signs;
+        progress.precision = pow(10.0, -state->precision);
+        progress.ml = state->result;
+        progress.fitsDone = 0;
+        progress.fitsTotal = cohort->tasksNumber;
+        for (int i = 0; i < cohort->tasksNumber; ++i)
+            progress.fitsDone += cohort->records[i].status == TASK_DONE;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    if (reporting) {
+        long long evaluations = 0;
+        for (int i = 0; i < cohort->tasksNumber; ++i)
+            evaluations += atomic_load_explicit(&cohort->tasks[i].evaluations, memory_order_relaxed);
+        progress.evaluations = evaluations;
+        progress.evaluationsPerSecond = now > cohort->lastReport ? (evaluations - cohort->lastReportEvaluations) / (now - cohort->lastReport) : 0.0;
+        ctx->progress(&progress, ctx->progressData);
+        pthread_mutex_lock(&pool->mutex);
+        cohort->reporting = 0;
+        cohort->lastReport = now;
+        cohort->lastReportEvaluations = evaluations;
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    if (!records) return;
+    if (writeCheckpoint(ctx->checkpointPath, &cohort->header, records) < 0)
+        message(ctx, "I could not write the checkpoint %s\n", ctx->checkpointPath);
+    free(records);
+    pthread_mutex_lock(&pool->mutex);
+    cohort->writingCheckpoint = 0;
+    cohort->lastCheckpoint = monotonicSeconds();
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+/* the log-likelihood at the powers u of the coefficients of the task and its gradient with respect to them */
+static double objectiveLBFGS(struct fitTask * task, const double * u, double * gradient) {
+    double coefficients[8], derivatives[8];
+    for (int i = 0; i < 8; ++i)
+        coefficients[i] = task->s[i] * pow(10.0, u[i]);
+    double result = gradientLogL(&task->ctx->data, task->func, task->ctx->polynOrder, coefficients, derivatives);
+    for (int i = 0; i < 8; ++i)
+        gradient[i] = derivatives[i] * coefficients[i] * M_LN10;
+    atomic_fetch_add_explicit(&task->evaluations, 1, memory_order_relaxed);
+    return result;
+}
+
+static double dot(const double * a, const double * b, int n) {
+    double sum = 0.0;
+    for (int i = 0; i < n; ++i)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+/* Continues the fit from the center of the lattice with the L-BFGS method in the same powers of the coefficients
+and returns the ML estimate. The coefficients above the polynomial order stay at 10^-300. The negative
+log-likelihood is minimized with backtracking steps that stop at the points where any probability is invalid */
+static double refineLBFGS(struct fitTask * task, double result) {
+    int n = task->ctx->polynOrder + 1;
+    double u[8], gradient[8], uNew[8], gradientNew[8], direction[8];
+    double steps[LBFGS_MEMORY][8], changes[LBFGS_MEMORY][8], rho[LBFGS_MEMORY], alpha[LBFGS_MEMORY];
+    int stored = 0, newest = 0;
+    for (int i = 0; i < 8; ++i)
+        u[i] = task->origin[i] + task->lattice[i] * pow(10.0, -task->precision);
+    double f = -objectiveLBFGS(task, u, gradient);
+    if (!isfinite(f)) return result;
+    for (int i = 0; i < 8; ++i)
+        gradient[i] = -gradient[i];
+    for (int iteration = 0; iteration < LBFGS_ITERATIONS && !stopSignal(task->cohort); ++iteration) {
+        PROFILE(++task->lbfgsIterations;)
+        /* the two-loop recursion gives the direction of the quasi-Newton step */
+        for (int i = 0; i < n; ++i)
+            direction[i] = -gradient[i];
+        for (int j = 0; j < stored; ++j) {
+            int m = (newest - j + LBFGS_MEMORY) % LBFGS_MEMORY;
+            alpha[m] = rho[m] * dot(steps[m], direction, n);
+            for (int i = 0; i < n; ++i)
+                direction[i] -= alpha[m] * changes[m][i];
+        }
+        if (stored) {
+            double gamma = dot(steps[newest], changes[newest], n) / dot(changes[newest], changes[newest], n);
+            for (int i = 0; i < n; ++i)
+                direction[i] *= gamma;
+        }
+        for (int j = stored - 1; j >= 0; --j) {
+            int m = (newest - j + LBFGS_MEMORY) % LBFGS_MEMORY;
+            double beta = rho[m] * dot(changes[m], direction, n);
+            for (int i = 0; i < n; ++i)
+                direction[i] += (alpha[m] - beta) * steps[m][i];
+        }
+        double slope = dot(gradient, direction, n);
+        if (!(slope < 0.0)) {
+            for (int i = 0; i < n; ++i)
+                direction[i] = -gradient[i];
+            slope = dot(gradient, direction, n);
+            stored = 0;
+        }
+        if (!(slope < 0.0)) break;
+        double largest = 0.0;
+        for (int i = 0; i < n; ++i)
+            if (fabs(direction[i]) > largest) largest = fabs(direction[i]);
+        double step = largest > LBFGS_MAX_STEP ? LBFGS_MAX_STEP / largest : 1.0;
+        double fNew = f;
+        int accepted = 0;
+        for (int k = 0; k < 60 && !accepted; ++k, step *= 0.5) {
+            for (int i = 0; i < 8; ++i)
+                uNew[i] = i < n ? u[i] + step * direction[i] : u[i];
+            fNew = -objectiveLBFGS(task, uNew, gradientNew);
+            accepted = isfinite(fNew) && fNew <= f + 1e-4 * step * slope;
+        }
+        if (!accepted) break;
+        for (int i = 0; i < 8; ++i)
+            gradientNew[i] = -gradientNew[i];
+        int m = (newest + 1) % LBFGS_MEMORY;
+        for (int i = 0; i < n; ++i) {
+            steps[m][i] = uNew[i] - u[i];
+            changes[m][i] = gradientNew[i] - gradient[i];
+        }
+        double curvature = dot(steps[m], changes[m], n);
+        if (curvature > 1e-12 * sqrt(dot(steps[m], steps[m], n) * dot(changes[m], changes[m], n))) {
+            rho[m] = 1.0 / curvature;
+            newest = m;
+            if (stored < LBFGS_MEMORY) ++stored;
+        }
+        double decrease = f - fNew;
+        for (int i = 0; i < 8; ++i) {
+            u[i] = uNew[i];
+            gradient[i] = gradientNew[i];
+        }
+        f = fNew;
+        if (decrease <= 1e-14 * fabs(f)) break;
+    }
+    /* the estimate is reported by the same kernel as with the lattice, so that the functions stay comparable */
+    double coefficients[8];
+    for (int i = 0; i < 8; ++i)
+        coefficients[i] = task->s[i] * pow(10.0, u[i]);
+    int abandoned = 0;
+    double refined = task->kernel(&task->ctx->data, coefficients, -INFINITY, &abandoned);
+    if (!(refined >= result)) return result;
+    for (int i = 0; i < 8; ++i) {
+        task->origin[i] = u[i];
+        task->lattice[i] = 0;
+    }
+    return refined;
+}
+
+static void printDeadLoopWarning(struct fitTask * task, double result, double resultPrev) {
+    if (resultPrev)
+        message(task->ctx, "***********************************************************************************\n\t\t%sIf you start to suspect that your computer got into a dead loop\n\t\t— Nope, the ML estimate is still increasing:\n\t\t\tit is %14.10f now\n\t\t\t  vs. %14.10f, which was 20 lines above\n***********************************************************************************\n", task->tag, result, resultPrev);
+    else
+        message(task->ctx, "***********************************************************************************\n\t\t%sIf you start to suspect that your computer got into a dead loop\n\t\t— Nope, the ML estimate is still increasing:\n\t\t\tit is %14.10f now\n***********************************************************************************\n", task->tag, result);
+}
+
+/* the powers of the coefficients where the hill climbing starts */
+static void seedOrigin(int polyn_order, double * origin) {
     /* Initial parameters (powers of coefficients), which can be changed.
     Both the speed of fitting and the local maximum where you're gonna get stuck highly depend on the choice of these initial parameters.
     Play with them to get better fitting.
@@ -305,7 +1219,22 @@ int fitFunction(double * ages, int * the_outcomes, int length, double * output,
     double b5_input_seed = polyn_order > 4 ? -9.2629 : -300.0;  // for the functions with the floor and ceiling, this is beta3, not beta5
     double b6_input_seed = polyn_order > 5 ? -26.0 : -300.0;    // for the functions with the floor and ceiling, this is beta4, not beta6
     double b7_input_seed = polyn_order > 6 ? -31.0 : -300.0;    // for the functions with the floor and ceiling, this is beta5, not beta7
-    double b0_input, b1_input, b2_input, b3_input, b4_input, b5_input, b6_input, b7_input;
+    origin[0] = b0_input_seed;
+    origin[1] = b1_input_seed;
+    origin[2] = b2_input_seed;
+    origin[3] = b3_input_seed;
+    origin[4] = b4_input_seed;
+    origin[5] = b5_input_seed;
+    origin[6] = b6_input_seed;
+    origin[7] = b7_input_seed;
+}
+
+/* the hill climbing of one function with one set of signs */
+static void runTask(struct workerPool * pool, struct fitTask * task) {
+    int polyn_order = task->ctx->polynOrder;
+    double result = 0.0;
+    double resultPrev = 0.0;
+    int position = 0;
     int b0_index = 0;
     int b1_index = 0;
     int b2_index = 0;
@@ -314,162 +1243,636 @@ int fitFunction(double * ages, int * the_outcomes, int length, double * output,
     int b5_index = 0;
     int b6_index = 0;
     int b7_index = 0;
-    int repeats;
+    int repeats = 0;
     int repeatsWarning = 0;
     double positionPrev;
     double tempCoefficient;
     double tempDropTermResult;
     double tempML;
-    int firstFunction = 1;
-    int resulting = 0;
-    for (int iFunc = START_FUNCTION - 1; iFunc < STOP_FUNCTION; ++iFunc) {
-        if (!functionsToTest[iFunc]) continue;
-        if (firstFunction) {
-            resulting = iFunc;
-            firstFunction = 0;
+    double * finalResults = task->output;
+    unsigned char signs = task->signs;
+    PROFILE(double started = monotonicSeconds();)
+    convertSigns(task);
+    task->result = malloc(GRID_SIZE * sizeof(double));
+    task->abandonedPoint = malloc(GRID_SIZE);
+    task->pending = malloc(GRID_SIZE * sizeof(int));
+    task->cache.capacity = CACHE_INITIAL_CAPACITY;
+    task->cache.entries = calloc(task->cache.capacity, sizeof(struct cacheEntry));
+    /* the record of the fit is left as it was, so that a checkpoint still resumes it */
+    if (!task->result || !task->abandonedPoint || !task->pending || !task->cache.entries) {
+        free(task->result);
+        free(task->abandonedPoint);
+        free(task->pending);
+        free(task->cache.entries);
+        task->result = NULL;
+        task->abandonedPoint = NULL;
+        task->pending = NULL;
+        task->cache.entries = NULL;
+        task->cache.capacity = 0;
+        task->failed = 1;
+        message(task->ctx, "%sI could not allocate the memory to fit the mortality data to %s with signs x%02x %s\n", task->cohort->tag, funcNames[task->func], signs, task->signString);
+        return;
+    }
+    task->started = 1;
+    task->cache.peakBytes = task->cache.capacity * sizeof(struct cacheEntry);
+    struct cohortFits * cohort = task->cohort;
+    if (cohort->index >= 0)
+        snprintf(task->tag, sizeof(task->tag), "[%d: %d %s] ", cohort->index, task->func, task->signString);
+    else if (pool->maxRunningTasks > 1)
+        snprintf(task->tag, sizeof(task->tag), "[%d %s] ", task->func, task->signString);
+    else
+        task->tag[0] = '\0';
+    pthread_mutex_lock(&pool->mutex);
+    struct checkpointRecord state = cohort->records[task - cohort->tasks];
+    pthread_mutex_unlock(&pool->mutex);
+    /* a fit resumed from a checkpoint goes on from the step it had made last */
+    int resuming = state.status == TASK_RUNNING;
+    if (resuming) {
+        for (int i = 0; i < 8; ++i) {
+            task->origin[i] = state.origin[i];
+            task->lattice[i] = state.lattice[i];
         }
-        signs = (unsigned char) * sign1;
-        while(1) {
-            convertSigns(iFunc);
-            b0_input = b0_input_seed;
-            b1_input = b1_input_seed;
-            b2_input = b2_input_seed;
-            b3_input = b3_input_seed;
-            b4_input = b4_input_seed;
-            b5_input = b5_input_seed;
-            b6_input = b6_input_seed;
-            b7_input = b7_input_seed;
-            repeatsWarning = 0;
-            result = 0.0;
-            resultPrev = 0.0;
-            printf("I started fitting the mortality data to %s with signs x%02x %s\n", funcNames[iFunc], signs, signString);
-            fflush(stdout);
-            for (int iPrecision=0; iPrecision < 5; ++iPrecision) {
+        task->precision = state.precision;
+        repeats = state.repeats;
+        repeatsWarning = state.repeatsWarning;
+        position = state.position;
+        result = state.result;
+        resultPrev = state.resultPrev;
+        message(task->ctx, "%sI resumed fitting the mortality data to %s with signs x%02x %s at precision %.4f\n", cohort->tag, funcNames[task->func], signs, task->signString, pow(10, -state.precision));
+    } else {
+        seedOrigin(polyn_order, task->origin);
+        task->precision = 0;
+        message(task->ctx, "%sI started fitting the mortality data to %s with signs x%02x %s\n", cohort->tag, funcNames[task->func], signs, task->signString);
+    }
+    state.status = TASK_RUNNING;
+    /* L-BFGS needs a start where all the probabilities are valid, which the lattice with the precision 1 finds */
+    int precisions = cohort->header.optimizer == DC_OPTIMIZER_LBFGS ? 1 : 5;
+    for (int iPrecision = resuming ? state.precision : 0; iPrecision < precisions; ++iPrecision) {
+        if (!resuming) {
+            ++repeatsWarning;
+            message(task->ctx, "\t%sFitting with precision %.4f\n", task->tag, pow(10, -iPrecision));
+            if (repeatsWarning % 20 == 19) {
+                printDeadLoopWarning(task, result, resultPrev);
+                resultPrev = result;
+            }
+            repeats = 0;
+            position = 0;
+        }
+        resuming = 0;
+        while (position != GRID_CENTER) {
+            if (repeats > 25 && iPrecision > 0) {
                 ++repeatsWarning;
-                printf("\tFitting with precision %.4f\n", pow(10, -iPrecision));
+                --iPrecision;
+                PROFILE(++task->backoffs;)
+                message(task->ctx, "\t%sFitting with precision %.4f again because slope ascending is too slow\n", task->tag, pow(10, -iPrecision));
                 if (repeatsWarning % 20 == 19) {
-                    printf("***********************************************************************************\n\t\tIf you start to suspect that your computer got into a dead loop\n\t\t— Nope, the ML estimate is still increasing:\n\t\t\tit is %14.10f now\n", result);
-                    if (resultPrev) printf("\t\t\t  vs. %14.10f, which was 20 lines above\n", resultPrev);
-                    puts("***********************************************************************************");
+                    printDeadLoopWarning(task, result, resultPrev);
                     resultPrev = result;
                 }
-                fflush(stdout);
-                repeats = 0;
-                position = 0;
-                while (position != 3280) {
-                    if (repeats > 25 && iPrecision > 0) {
-                        ++repeatsWarning;
-                        --iPrecision;
-                        printf("\tFitting with precision %.4f again because slope ascending is too slow\n", pow(10, -iPrecision));
-                        if (repeatsWarning % 20 == 19) {
-                            printf("***********************************************************************************\n\t\tIf you start to suspect that your computer got into a dead loop\n\t\t— Nope, the ML estimate is still increasing:\n\t\t\tit is %14.10f now\n", result);
-                            if (resultPrev) printf("\t\t\t  vs. %14.10f, which was 20 lines above\n", resultPrev);
-                            puts("***********************************************************************************");
-                            resultPrev = result;
-                        }
-                        fflush(stdout);
-                    }
-                    positionPrev = position;
-                    position = oneStep(iFunc, &result, ages, the_outcomes, length, b0_input, b1_input, b2_input, b3_input, b4_input, b5_input, b6_input, b7_input, iPrecision);
-                    //printf("%15.10f\t", result);      // this may be uncommented to print each ML estimate along the way
-                    fflush(stdout);
-                    b0_index = position / 2187;
-                    b1_index = position % 2187 / 729;
-                    b2_index = position % 729 / 243;
-                    b3_index = position % 243 / 81;
-                    b4_index = position % 81 / 27;
-                    b5_index = position % 27 / 9;
-                    b6_index = position % 9 / 3;
-                    b7_index = position % 3;
-                    b0_input += (b0_index - 1) * pow(10.0, -iPrecision);
-                    b1_input += (b1_index - 1) * pow(10.0, -iPrecision);
-                    b2_input += (b2_index - 1) * pow(10.0, -iPrecision);
-                    b3_input += (b3_index - 1) * pow(10.0, -iPrecision);
-                    b4_input += (b4_index - 1) * pow(10.0, -iPrecision);
-                    b5_input += (b5_index - 1) * pow(10.0, -iPrecision);
-                    b6_input += (b6_index - 1) * pow(10.0, -iPrecision);
-                    b7_input += (b7_index - 1) * pow(10.0, -iPrecision);
-                    if (positionPrev == position) ++repeats;
-                    if ((fp = fopen("stop.txt", "r")) != NULL) {
-                        fclose(fp);
-                        break;
-                    }
-                }
-                if ((fp = fopen("stop.txt", "r")) != NULL) {
-                    fclose(fp);
-                    fflush(stdout);
-                    break;
-                }
             }
-            if (signs == (unsigned char) * sign1 || result > finalResults[iFunc][8]) {
-                finalResults[iFunc][0] = pow(10.0, b0_input);
-                finalResults[iFunc][1] = pow(10.0, b1_input);
-                finalResults[iFunc][2] = pow(10.0, b2_input);
-                finalResults[iFunc][3] = pow(10.0, b3_input);
-                finalResults[iFunc][4] = pow(10.0, b4_input);
-                finalResults[iFunc][5] = pow(10.0, b5_input);
-                finalResults[iFunc][6] = pow(10.0, b6_input);
-                finalResults[iFunc][7] = pow(10.0, b7_input);
-                finalResults[iFunc][8] = result;
-                finalSigns[iFunc] = signs;
-                for (int i=0; i < 8; ++i) {
-                    tempCoefficient = finalResults[iFunc][i];
-                    tempML = testFunc[func_g](80.0, 1, finalResults[iFunc][0],
-                                                        finalResults[iFunc][1],
-                                                        finalResults[iFunc][2],
-                                                        finalResults[iFunc][3],
-                                                        finalResults[iFunc][4],
-                                                        finalResults[iFunc][5],
-                                                        finalResults[iFunc][6],
-                                                        finalResults[iFunc][7]);
-                    finalResults[iFunc][i] = 0.0;
-                    tempDropTermResult = testFunc[func_g](80.0, 1, finalResults[iFunc][0],
-                                                                    finalResults[iFunc][1],
-                                                                    finalResults[iFunc][2],
-                                                                    finalResults[iFunc][3],
-                                                                    finalResults[iFunc][4],
-                                                                    finalResults[iFunc][5],
-                                                                    finalResults[iFunc][6],
-                                                                    finalResults[iFunc][7]);
-                    if (tempML != tempDropTermResult)
-                        finalResults[iFunc][i] = tempCoefficient;
-                }
-                if(finalResults[iFunc][0]) finalResults[iFunc][0] *= pow(-1.0, (double) (signs & (unsigned char) 0b00000001));
-                if(finalResults[iFunc][1]) finalResults[iFunc][1] *= pow(-1.0, (double) ((signs & (unsigned char) 0b00000010) >> 1));
-                if(finalResults[iFunc][2]) finalResults[iFunc][2] *= pow(-1.0, (double) ((signs & (unsigned char) 0b00000100) >> 2));
-                if(finalResults[iFunc][3]) finalResults[iFunc][3] *= pow(-1.0, (double) ((signs & (unsigned char) 0b00001000) >> 3));
-                if(finalResults[iFunc][4]) finalResults[iFunc][4] *= pow(-1.0, (double) ((signs & (unsigned char) 0b00010000) >> 4));
-                if(finalResults[iFunc][5]) finalResults[iFunc][5] *= pow(-1.0, (double) ((signs & (unsigned char) 0b00100000) >> 5));
-                if(finalResults[iFunc][6]) finalResults[iFunc][6] *= pow(-1.0, (double) ((signs & (unsigned char) 0b01000000) >> 6));
-                if(finalResults[iFunc][7]) finalResults[iFunc][7] *= pow(-1.0, (double) ((signs & (unsigned char) 0b10000000) >> 7));
+            positionPrev = position;
+            setPrecision(task, iPrecision);
+            position = oneStep(pool, task, &result);
+            PROFILE(++task->steps[iPrecision];)
+            //message(task->ctx, "%15.10f\t", result);      // this may be uncommented to print each ML estimate along the way
+            b0_index = position / 2187;
+            b1_index = position % 2187 / 729;
+            b2_index = position % 729 / 243;
+            b3_index = position % 243 / 81;
+            b4_index = position % 81 / 27;
+            b5_index = position % 27 / 9;
+            b6_index = position % 9 / 3;
+            b7_index = position % 3;
+            task->lattice[0] += b0_index - 1;
+            task->lattice[1] += b1_index - 1;
+            task->lattice[2] += b2_index - 1;
+            task->lattice[3] += b3_index - 1;
+            task->lattice[4] += b4_index - 1;
+            task->lattice[5] += b5_index - 1;
+            task->lattice[6] += b6_index - 1;
+            task->lattice[7] += b7_index - 1;
+            if (positionPrev == position) ++repeats;
+            state.precision = iPrecision;
+            state.repeats = repeats;
+            state.repeatsWarning = repeatsWarning;
+            state.position = position;
+            state.result = result;
+            state.resultPrev = resultPrev;
+            for (int i = 0; i < 8; ++i) {
+                state.origin[i] = task->origin[i];
+                state.lattice[i] = task->lattice[i];
+            }
+            saveProgress(pool, task, &state);
+            if (stopSignal(cohort))
+                break;
+        }
+        if (stopSignal(cohort))
+            break;
+    }
+    if (cohort->header.optimizer == DC_OPTIMIZER_LBFGS && !stopSignal(cohort)) {
+        message(task->ctx, "\t%sRefining with L-BFGS from ML %.10f\n", task->tag, result);
+        result = refineLBFGS(task, result);
+    }
+    free(task->result);
+    free(task->abandonedPoint);
+    free(task->pending);
+    free(task->cache.entries);
+    for (int i=0; i < 8; ++i)
+        finalResults[i] = pow(10.0, task->origin[i] + task->lattice[i] * pow(10.0, -task->precision));
+    finalResults[8] = result;
+    for (int i=0; i < 8; ++i) {
+        tempCoefficient = finalResults[i];
+        tempML = testFunc[task->func](80.0, 1, finalResults[0],
+                                               finalResults[1],
+                                               finalResults[2],
+                                               finalResults[3],
+                                               finalResults[4],
+                                               finalResults[5],
+                                               finalResults[6],
+                                               finalResults[7]);
+        finalResults[i] = 0.0;
+        tempDropTermResult = testFunc[task->func](80.0, 1, finalResults[0],
+                                                           finalResults[1],
+                                                           finalResults[2],
+                                                           finalResults[3],
+                                                           finalResults[4],
+                                                           finalResults[5],
+                                                           finalResults[6],
+                                                           finalResults[7]);
+        if (tempML != tempDropTermResult)
+            finalResults[i] = tempCoefficient;
+    }
+    if(finalResults[0]) finalResults[0] *= pow(-1.0, (double) (signs & (unsigned char) 0b00000001));
+    if(finalResults[1]) finalResults[1] *= pow(-1.0, (double) ((signs & (unsigned char) 0b00000010) >> 1));
+    if(finalResults[2]) finalResults[2] *= pow(-1.0, (double) ((signs & (unsigned char) 0b00000100) >> 2));
+    if(finalResults[3]) finalResults[3] *= pow(-1.0, (double) ((signs & (unsigned char) 0b00001000) >> 3));
+    if(finalResults[4]) finalResults[4] *= pow(-1.0, (double) ((signs & (unsigned char) 0b00010000) >> 4));
+    if(finalResults[5]) finalResults[5] *= pow(-1.0, (double) ((signs & (unsigned char) 0b00100000) >> 5));
+    if(finalResults[6]) finalResults[6] *= pow(-1.0, (double) ((signs & (unsigned char) 0b01000000) >> 6));
+    if(finalResults[7]) finalResults[7] *= pow(-1.0, (double) ((signs & (unsigned char) 0b10000000) >> 7));
+    message(task->ctx, "\t\t%sML is %20.16f\n", task->tag, result);
+    PROFILE(task->seconds = monotonicSeconds() - started;)
+    /* a fit that was stopped stays running in the checkpoint, so that it is resumed rather than taken as it is */
+    if (!atomic_load(&cohort->cancelled)) {
+        state.status = TASK_DONE;
+        for (int i = 0; i < 9; ++i)
+            state.output[i] = finalResults[i];
+        saveProgress(pool, task, &state);
+    }
+}
+
+/* a queued fit is skipped if it finished before the fit was resumed or if its context has been stopped */
+static int skipTask(struct fitTask * task) {
+    struct cohortFits * cohort = task->cohort;
+    return cohort->records[task - cohort->tasks].status == TASK_DONE || stopSignal(cohort);
+}
+
+/* the loop of the worker threads, which the calling thread also runs until all the fits are finished */
+static void poolLoop(struct workerPool * pool, int caller) {
+    pthread_mutex_lock(&pool->mutex);
+    while (1) {
+        if (pool->jobs) {
+            struct stepJob * job = pool->jobs;
+            ++job->users;
+            pthread_mutex_unlock(&pool->mutex);
+            runChunks(pool, job, 0);
+            pthread_mutex_lock(&pool->mutex);
+            releaseJob(pool, job);
+            continue;
+        }
+        while (pool->nextTask < pool->queueLength && skipTask(pool->queue[pool->nextTask]))
+            ++pool->nextTask;
+        if (pool->nextTask < pool->queueLength && pool->runningTasks < pool->maxRunningTasks) {
+            struct fitTask * task = pool->queue[pool->nextTask++];
+            ++pool->runningTasks;
+            pthread_mutex_unlock(&pool->mutex);
+            runTask(pool, task);
+            pthread_mutex_lock(&pool->mutex);
+            --pool->runningTasks;
+            pthread_cond_broadcast(&pool->wake);
+            continue;
+        }
+        if (caller ? !pool->runningTasks && pool->nextTask == pool->queueLength : pool->stop)
+            break;
+        pthread_cond_wait(&pool->wake, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+static void * poolWorker(void * arg) {
+    poolLoop(arg, 0);
+    return NULL;
+}
+
+/* sizes the pool to the threads and splits them between the fits: a step with few grid points gets few threads, and more fits run at once;
+returns -1 if the memory could not be allocated or a thread could not be started, and then only the started threads are left to poolDestroy */
+static int poolCreate(struct workerPool * pool, int threads, struct fitTask ** queue, int queueLength, int points) {
+    if (threads <= 0) threads = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads <= 0) threads = 1;
+    pool->workers = threads - 1;
+    pool->share = points / MIN_POINTS_PER_THREAD;
+    if (pool->share > threads) pool->share = threads;
+    if (pool->share < 1) pool->share = 1;
+    pool->maxRunningTasks = (threads + pool->share - 1) / pool->share;
+    if (pool->maxRunningTasks > queueLength) pool->maxRunningTasks = queueLength;
+    if (pool->maxRunningTasks < 1) pool->maxRunningTasks = 1;
+    pool->threads = malloc((pool->workers + 1) * sizeof(pthread_t));
+    if (!pool->threads) return -1;
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->jobs = NULL;
+    pool->queue = queue;
+    pool->queueLength = queueLength;
+    pool->nextTask = pool->runningTasks = pool->stop = 0;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, 262144);
+    PROFILE(double started = monotonicSeconds();)
+    /* the started threads wait for the mutex until all are started, so that after a failure they take no fits
+    and see only the number of threads that exist */
+    pthread_mutex_lock(&pool->mutex);
+    int workers = 0;
+    while (workers < pool->workers && pthread_create(&pool->threads[workers], &attr, poolWorker, pool) == 0)
+        ++workers;
+    int failed = workers < pool->workers;
+    if (failed) {
+        pool->workers = workers;
+        pool->nextTask = pool->queueLength;
+        pool->stop = 1;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    PROFILE(pool->spawnSeconds = monotonicSeconds() - started;)
+    pthread_attr_destroy(&attr);
+    return failed ? -1 : 0;
+}
+
+static void poolDestroy(struct workerPool * pool) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->mutex);
+    PROFILE(double started = monotonicSeconds();)
+    for (int i = 0; i < pool->workers; ++i)
+        pthread_join(pool->threads[i], NULL);
+    PROFILE(pool->joinSeconds = monotonicSeconds() - started;)
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->done);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool->threads);
+}
+
+/* sets the number of threads for the following fitFunction calls; 0 restores the default of one thread per online CPU core */
+void setThreadsNumber(int threads) {
+    atomic_store(&threadsNumber_g, threads > 0 ? threads : 0);
+}
+
+/* sets the optimizer for the following fitFunction calls */
+int setOptimizer(int optimizer) {
+    if (optimizer != DC_OPTIMIZER_LATTICE && optimizer != DC_OPTIMIZER_LBFGS) return -1;
+    atomic_store(&optimizer_g, optimizer);
+    return 0;
+}
+
+dcContext * dcCreate(const double * ages, const int * outcomes, int length, int polyn_order) {
+    if (polyn_order < 2 || polyn_order > 7 || length < 0) return NULL;    // the kernels are instantiated for these orders only
+    dcContext * ctx = calloc(1, sizeof(dcContext));
+    if (!ctx) return NULL;
+    ctx->polynOrder = polyn_order;
+    ctx->order = 8 - polyn_order;
+    ctx->start = ((int) pow(3, 7 - polyn_order)) / 2;
+    ctx->skip = (int) pow(3, 7 - polyn_order);
+    ctx->console = 1;
+    ctx->shardCount = 1;
+    if (compressData(&ctx->data, ages, outcomes, length) < 0) {
+        dcDestroy(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+void dcSetThreads(dcContext * ctx, int threads) {
+    ctx->threads = threads > 0 ? threads : 0;
+}
+
+int dcSetOptimizer(dcContext * ctx, int optimizer) {
+    if (optimizer != DC_OPTIMIZER_LATTICE && optimizer != DC_OPTIMIZER_LBFGS) return -1;
+    ctx->optimizer = optimizer;
+    return 0;
+}
+
+void dcGetCounters(const dcContext * ctx, dcCounters * counters) {
+    counters->evaluations = atomic_load(&ctx->evaluations);
+    counters->abandoned = atomic_load(&ctx->abandoned);
+    counters->cacheLookups = atomic_load(&ctx->cacheLookups);
+    counters->cacheHits = atomic_load(&ctx->cacheHits);
+    counters->cacheBytes = atomic_load(&ctx->cacheBytes);
+}
+
+int dcSetCheckpoint(dcContext * ctx, const char * path, double interval) {
+    char * copy = NULL;
+    if (path) {
+        if (!(copy = malloc(strlen(path) + 1))) return -1;
+        strcpy(copy, path);
+    }
+    free(ctx->checkpointPath);
+    ctx->checkpointPath = copy;
+    ctx->checkpointInterval = interval > 0.0 ? interval : 0.0;
+    return 0;
+}
+
+void dcSetProgress(dcContext * ctx, dcProgressCallback callback, void * userData, double interval) {
+    ctx->progress = callback;
+    ctx->progressData = userData;
+    ctx->progressInterval = interval > 0.0 ? interval : 0.0;
+}
+
+void dcSetCancelFlag(dcContext * ctx, const atomic_int * flag) {
+    ctx->cancelFlag = flag;
+}
+
+int dcSetStopFile(dcContext * ctx, const char * path) {
+    char * copy = NULL;
+    if (path) {
+        if (!(copy = malloc(strlen(path) + 1))) return -1;
+        strcpy(copy, path);
+    }
+    free(ctx->stopFile);
+    ctx->stopFile = copy;
+    return 0;
+}
+
+void dcSetConsole(dcContext * ctx, int enabled) {
+    ctx->console = enabled != 0;
+}
+
+int dcSetShard(dcContext * ctx, int index, int count) {
+    if (count < 1 || index < 0 || index >= count) return -1;
+    ctx->shardIndex = index;
+    ctx->shardCount = count;
+    return 0;
+}
+
+int dcCheckpointOrder(const char * path) {
+    struct checkpointHeader header;
+    struct checkpointRecord * records;
+    if (readCheckpoint(path, &header, &records) < 0) return -1;
+    free(records);
+    return header.polynOrder;
+}
+
+int dcCheckpointShards(const char * path) {
+    struct checkpointHeader header;
+    struct checkpointRecord * records;
+    if (readCheckpoint(path, &header, &records) < 0) return -1;
+    free(records);
+    return header.shardCount;
+}
+
+/* without -DDEATHCURVE_PROFILE, the profile is all zero, and its enabled flag tells that profiling is unavailable */
+void dcGetProfile(const dcContext * ctx, dcProfile * profile) {
+#ifdef DEATHCURVE_PROFILE
+    * profile = ctx->profile;
+#else
+    (void) ctx;
+    memset(profile, 0, sizeof(dcProfile));
+#endif
+}
+
+void dcDestroy(dcContext * ctx) {
+    if (!ctx) return;
+    free(ctx->checkpointPath);
+    free(ctx->stopFile);
+    freeData(&ctx->data);
+    free(ctx);
+}
+
+/* lists the fits of the functions with their signs in the order they used to run one after another, keeping those
+whose positions in the list modulo shardCount are shardIndex, and returns their number */
+static int listFits(int polyn_order, int sign1, int sign2, const int * functionsToTest, int shardIndex, int shardCount, struct checkpointRecord * records) {
+    int listed = 0, position = 0;
+    for (int iFunc = START_FUNCTION - 1; iFunc < STOP_FUNCTION; ++iFunc) {
+        if (!functionsToTest[iFunc]) continue;
+        unsigned char signs = (unsigned char) sign1;
+        while(1) {
+            if (position++ % shardCount == shardIndex) {
+                records[listed].func = iFunc;
+                records[listed].signs = signs;
+                records[listed].status = TASK_PENDING;
+                ++listed;
             }
-            printf("\t\tML is %20.16f\n", result);
-            fflush(stdout);
             if (sign2) break;
             if (signs == (unsigned char) (pow(2, polyn_order + 1) - 1)) break;
             ++signs;
             if (iFunc % 2 && (signs & (unsigned char) 0b11000000)) break;
-            if ((fp = fopen("stop.txt", "r")) != NULL) {
-                fclose(fp);
-                fflush(stdout);
-                break;
-            }
         }
-        if ((fp = fopen("stop.txt", "r")) != NULL) {
-            fclose(fp);
-            remove("stop.txt");
-            puts("I have received the signal to stop. The calculation has stoped. You will see the intermediate results.");
-            fflush(stdout);
-            break;
+    }
+    return listed;
+}
+
+/* the results are merged in the order of the list, so the choice among equally good signs is the same as when the fits ran one after another */
+static void mergeFit(int func, unsigned char signs, const double * output, int sign1, double finalResults[][9], unsigned char * finalSigns) {
+    if (signs == (unsigned char) sign1 || output[8] > finalResults[func][8]) {
+        for (int j = 0; j < 9; ++j)
+            finalResults[func][j] = output[j];
+        finalSigns[func] = signs;
+    }
+}
+
+/* returns the flagged function with the best ML estimate, the first one of equally good ones, or -1 if none is flagged */
+static int bestFunction(const int * functions, double finalResults[][9]) {
+    int resulting = -1;
+    for (int iFunc = START_FUNCTION - 1; iFunc < STOP_FUNCTION; ++iFunc) {
+        if (!functions[iFunc]) continue;
+        if (resulting < 0 || finalResults[iFunc][8] > finalResults[resulting][8])
+            resulting = iFunc;
+    }
+    return resulting;
+}
+
+static void cohortFree(struct cohortFits * cohort) {
+    free(cohort->tasks);
+    free(cohort->records);
+}
+
+/* lists the fits of the context, which are taken from the records of its checkpoint when dcResume passes them;
+returns -1 if the memory could not be allocated or the records are not of the same list */
+static int cohortCreate(struct cohortFits * cohort, dcContext * ctx, int index, int sign1, int sign2, const int * functionsToTest, int optimizer,
+                        int shardIndex, int shardCount, const struct checkpointRecord * resumed, int resumedNumber) {
+    PROFILE(cohort->started = monotonicSeconds();)
+    cohort->ctx = ctx;
+    cohort->index = index;
+    if (index >= 0)
+        snprintf(cohort->tag, sizeof(cohort->tag), "[%d] ", index);
+    else
+        cohort->tag[0] = '\0';
+    /* the fits of all functions with all sets of signs are independent of each other, so they are listed
+    in the order they used to run one after another and are handed to the worker pool together */
+    cohort->tasks = calloc(TOTAL_NUMBER_OF_FUNCTIONS * MAX_SIGN_PATTERNS, sizeof(struct fitTask));
+    cohort->records = calloc(TOTAL_NUMBER_OF_FUNCTIONS * MAX_SIGN_PATTERNS, sizeof(struct checkpointRecord));
+    if (!cohort->tasks || !cohort->records) {
+        cohortFree(cohort);
+        return -1;
+    }
+    struct fitTask * tasks = cohort->tasks;
+    struct checkpointRecord * records = cohort->records;
+    int tasksNumber = cohort->tasksNumber = listFits(ctx->polynOrder, sign1, sign2, functionsToTest, shardIndex, shardCount, records);
+    /* the lists are rarely full, and dcBootstrap keeps the lists of many replicates at once */
+    struct fitTask * shrunkTasks = realloc(tasks, (tasksNumber + 1) * sizeof(struct fitTask));
+    struct checkpointRecord * shrunkRecords = realloc(records, (tasksNumber + 1) * sizeof(struct checkpointRecord));
+    if (shrunkTasks) tasks = cohort->tasks = shrunkTasks;
+    if (shrunkRecords) records = cohort->records = shrunkRecords;
+    for (int i = 0; i < tasksNumber; ++i) {
+        tasks[i].ctx = ctx;
+        tasks[i].cohort = cohort;
+        tasks[i].func = records[i].func;
+        tasks[i].signs = (unsigned char) records[i].signs;
+        tasks[i].kernel = kernelFor(records[i].func, ctx->polynOrder);
+    }
+    /* a checkpoint is only resumed into the same list of fits */
+    if (resumed) {
+        int matches = resumedNumber == tasksNumber;
+        for (int i = 0; matches && i < tasksNumber; ++i)
+            matches = resumed[i].func == records[i].func && resumed[i].signs == records[i].signs
+                   && resumed[i].status >= TASK_PENDING && resumed[i].status <= TASK_DONE;
+        if (!matches) {
+            cohortFree(cohort);
+            return -1;
+        }
+        for (int i = 0; i < tasksNumber; ++i) {
+            records[i] = resumed[i];
+            if (records[i].status != TASK_DONE) continue;
+            tasks[i].started = 1;
+            for (int j = 0; j < 9; ++j)
+                tasks[i].output[j] = records[i].output[j];
         }
     }
+    cohort->writingCheckpoint = cohort->reporting = 0;
+    cohort->lastCheckpoint = cohort->lastReport = monotonicSeconds();
+    cohort->lastReportEvaluations = 0;
+    atomic_init(&cohort->cancelled, 0);
+    struct checkpointHeader * header = &cohort->header;
+    memset(header, 0, sizeof(* header));
+    memcpy(header->magic, "DCCKPT\0\0", 8);
+    header->version = CHECKPOINT_VERSION;
+    header->polynOrder = ctx->polynOrder;
+    header->optimizer = optimizer;
+    header->sign1 = sign1;
+    header->sign2 = sign2;
+    for (int i = 0; i < TOTAL_NUMBER_OF_FUNCTIONS; ++i)
+        header->functionsToTest[i] = functionsToTest[i] != 0;
+    header->bins = ctx->data.bins;
+    header->tasksNumber = tasksNumber;
+    header->shardIndex = shardIndex;
+    header->shardCount = shardCount;
+    header->dataHash = ctx->checkpointPath ? hashData(&ctx->data) : 0;
+    header->submaxAge = submaxAge(&ctx->data);
+    return 0;
+}
+
+/* runs the fits of the contexts on one pool with the threads of the first context, the fits of each context in the order of
+its list and the contexts one after another, so that the first fits of a context fill the cores left idle by the last ones of
+the previous context; returns -1 if the memory could not be allocated or the threads could not be started */
+static int runCohorts(struct workerPool * pool, struct cohortFits * cohorts, int count) {
+    int queueLength = 0, points = 0;
+    for (int i = 0; i < count; ++i) {
+        const dcContext * ctx = cohorts[i].ctx;
+        int cohortPoints = (GRID_SIZE - ctx->start + ctx->skip - 1) / ctx->skip;
+        queueLength += cohorts[i].tasksNumber;
+        if (cohortPoints > points) points = cohortPoints;
+    }
+    struct fitTask ** queue = malloc((queueLength + 1) * sizeof(struct fitTask *));
+    if (!queue) return -1;
+    queueLength = 0;
+    for (int i = 0; i < count; ++i)
+        for (int j = 0; j < cohorts[i].tasksNumber; ++j)
+            queue[queueLength++] = &cohorts[i].tasks[j];
+    int created = poolCreate(pool, cohorts[0].ctx->threads, queue, queueLength, points);
+    if (created < 0 && !pool->threads) {
+        free(queue);
+        return -1;
+    }
+    if (created == 0)
+        poolLoop(pool, 1);
+    poolDestroy(pool);
+    free(queue);
+    return created;
+}
+
+/* writes the last checkpoint of the fits of the context, merges their results, prints the summary, and frees them;
+returns the best function as dcFit does, or -1 if the memory of one of the fits could not be allocated */
+static int cohortFinish(struct cohortFits * cohort, const struct workerPool * pool, double * output, int * sign1) {
+    dcContext * ctx = cohort->ctx;
+    struct fitTask * tasks = cohort->tasks;
+    int tasksNumber = cohort->tasksNumber;
+    char signString[9];
+    double finalResults[STOP_FUNCTION][9] = {{0.0}};
+    unsigned char finalSigns[STOP_FUNCTION];
+    for (int i = 0; i < STOP_FUNCTION; ++i) {
+        finalResults[i][8] = -1e100;
+        finalSigns[i] = (unsigned char) cohort->header.sign1;
+    }
+    int listedFunctions[TOTAL_NUMBER_OF_FUNCTIONS] = {0};    // the functions with fits in this shard
+    int failed = 0;
+    for (int i = 0; i < tasksNumber; ++i) {
+        listedFunctions[tasks[i].func] = 1;
+        failed |= tasks[i].failed;
+    }
+    int cancelled = atomic_load(&cohort->cancelled);
+    if (ctx->checkpointPath && writeCheckpoint(ctx->checkpointPath, &cohort->header, cohort->records) < 0)
+        message(ctx, "I could not write the checkpoint %s\n", ctx->checkpointPath);
+
+    for (int i = 0; i < tasksNumber; ++i)
+        if (tasks[i].started)
+            mergeFit(tasks[i].func, tasks[i].signs, tasks[i].output, cohort->header.sign1, finalResults, finalSigns);
+    long long evaluations = 0, abandoned = 0, cacheLookups = 0, cacheHits = 0, cacheBytes = 0;
+    for (int i = 0; i < tasksNumber; ++i) {
+        evaluations += atomic_load(&tasks[i].evaluations);
+        abandoned += atomic_load(&tasks[i].abandoned);
+        cacheLookups += tasks[i].cache.lookups;
+        cacheHits += tasks[i].cache.hits;
+        if ((long long) tasks[i].cache.peakBytes > cacheBytes) cacheBytes = tasks[i].cache.peakBytes;
+    }
+    atomic_store(&ctx->evaluations, evaluations);
+    atomic_store(&ctx->abandoned, abandoned);
+    atomic_store(&ctx->cacheLookups, cacheLookups);
+    atomic_store(&ctx->cacheHits, cacheHits);
+    atomic_store(&ctx->cacheBytes, cacheBytes);
+#ifdef DEATHCURVE_PROFILE
+    dcProfile * profile = &ctx->profile;
+    memset(profile, 0, sizeof(dcProfile));
+    profile->enabled = 1;
+    for (int i = 0; i < tasksNumber; ++i) {
+        for (int j = 0; j < 5; ++j)
+            profile->steps[j] += tasks[i].steps[j];
+        profile->backoffs += tasks[i].backoffs;
+        profile->lbfgsIterations += tasks[i].lbfgsIterations;
+        profile->computeSeconds += atomic_load(&tasks[i].computeNanoseconds) * 1e-9;
+        profile->fitSeconds[tasks[i].func][tasks[i].signs] = tasks[i].seconds;
+    }
+    profile->spawnSeconds = pool->spawnSeconds;
+    profile->joinSeconds = pool->joinSeconds;
+    profile->wallSeconds = monotonicSeconds() - cohort->started;
+#else
+    (void) pool;
+#endif
+    cohortFree(cohort);
+    if (cancelled) {
+        if (ctx->stopFile) remove(ctx->stopFile);
+        message(ctx, "%sI have received the signal to stop. The calculation has stoped. You will see the intermediate results.\n", cohort->tag);
+        if (ctx->checkpointPath)
+            message(ctx, "%sThe fits can be resumed from the checkpoint %s\n", cohort->tag, ctx->checkpointPath);
+    }
+    if (failed)
+        return -1;
+    if (cohort->index >= 0)
+        message(ctx, "\nThe fits of the cohort %d:\n", cohort->index);
     
     /* the output below help compare the ten functions in terms of their fit to the data */
     for (int iFunc = START_FUNCTION - 1; iFunc < STOP_FUNCTION; ++iFunc) {
-        signs = finalSigns[iFunc];
-        convertSigns(iFunc);
-        if (!functionsToTest[iFunc]) continue;
-        printf("\nFunction %i:\t\t%s\n\tML estimate:\t%.16f\n\tParameters:\t%.6e %.6e %.6e %.6e %.6e %.6e %.6e %.6e\n\tSigns:\t\tx%02x\t%s\n",
+        if (!listedFunctions[iFunc]) continue;
+        signsToString(finalSigns[iFunc], signString);
+        message(ctx, "\nFunction %i:\t\t%s\n\tML estimate:\t%.16f\n\tParameters:\t%.6e %.6e %.6e %.6e %.6e %.6e %.6e %.6e\n\tSigns:\t\tx%02x\t%s\n",
                iFunc,
                funcNames[iFunc],
                finalResults[iFunc][8],
@@ -484,14 +1887,393 @@ int fitFunction(double * ages, int * the_outcomes, int length, double * output,
                finalSigns[iFunc],
                signString);
     }
-    fflush(stdout);
-    for (int iFunc = START_FUNCTION - 1; iFunc < STOP_FUNCTION; ++iFunc) {
-        if (!functionsToTest[iFunc]) continue;
-        if (iFunc == resulting) continue;
-        if (finalResults[iFunc][8] > finalResults[resulting][8])
-            resulting = iFunc;
-    }
+    if (evaluations)
+        message(ctx, "\nGrid points evaluated:\t%lld\n\tabandoned early:\t%lld (%.1f%%)\n", evaluations, abandoned, 100.0 * abandoned / evaluations);
+    if (cacheLookups)
+        message(ctx, "Grid points taken from the cache:\t%lld of %lld (%.1f%%)\n\tthe largest cache:\t%.1f KiB\n", cacheHits, cacheLookups, 100.0 * cacheHits / cacheLookups, cacheBytes / 1024.0);
+#ifdef DEATHCURVE_PROFILE
+    message(ctx, "Steps at the precisions from 1 to 0.0001:\t%lld %lld %lld %lld %lld\n\treturns to a coarser precision:\t%lld\n\tL-BFGS iterations:\t%lld\n",
+            profile->steps[0], profile->steps[1], profile->steps[2], profile->steps[3], profile->steps[4], profile->backoffs, profile->lbfgsIterations);
+    message(ctx, "Wall time:\t%.3f s\n\tgrid points computed for:\t%.3f thread-seconds\n\tthreads spawned in:\t%.3f ms\n\tthreads joined in:\t%.3f ms\n",
+            profile->wallSeconds, profile->computeSeconds, profile->spawnSeconds * 1e3, profile->joinSeconds * 1e3);
+#endif
+    int resulting = bestFunction(listedFunctions, finalResults);
+    if (resulting < 0) resulting = START_FUNCTION - 1;     // a shard without fits
     for (int i=0; i < 9; ++i) output[i] = finalResults[resulting][i];
     *sign1 = (int) finalSigns[resulting];
     return resulting;
 }
+
+/* the fits of dcFit and dcResume, which passes the records of the fits from its checkpoint */
+static int fitTasks(dcContext * ctx, double * output, int * sign1, int sign2, const int * functionsToTest, int optimizer,
+                    int shardIndex, int shardCount, const struct checkpointRecord * resumed, int resumedNumber) {
+    struct cohortFits cohort;
+    struct workerPool pool;
+    if (cohortCreate(&cohort, ctx, -1, * sign1, sign2, functionsToTest, optimizer, shardIndex, shardCount, resumed, resumedNumber) < 0)
+        return -1;
+    if (runCohorts(&pool, &cohort, 1) < 0) {
+        cohortFree(&cohort);
+        return -1;
+    }
+    return cohortFinish(&cohort, &pool, output, sign1);
+}
+
+int dcFit(dcContext * ctx, double * output, int * sign1, int sign2, const int * functionsToTest) {
+    return fitTasks(ctx, output, sign1, sign2, functionsToTest, ctx->optimizer, ctx->shardIndex, ctx->shardCount, NULL, 0);
+}
+
+int dcFitBatch(dcContext * const * contexts, int count, double * outputs, int * sign1, int sign2, const int * functionsToTest, int * functions) {
+    if (count < 1) return 0;
+    struct cohortFits * cohorts = calloc(count, sizeof(struct cohortFits));
+    struct workerPool pool;
+    int created = 0;
+    while (cohorts && created < count
+           && cohortCreate(&cohorts[created], contexts[created], created, sign1[created], sign2, functionsToTest, contexts[created]->optimizer,
+                           contexts[created]->shardIndex, contexts[created]->shardCount, NULL, 0) == 0)
+        ++created;
+    if (created < count || runCohorts(&pool, cohorts, count) < 0) {
+        for (int i = 0; i < created; ++i)
+            cohortFree(&cohorts[i]);
+        free(cohorts);
+        return -1;
+    }
+    int failed = 0;
+    for (int i = 0; i < count; ++i)
+        failed |= (functions[i] = cohortFinish(&cohorts[i], &pool, outputs + 9 * i, &sign1[i])) < 0;
+    free(cohorts);
+    return failed ? -1 : 0;
+}
+
+int dcResume(dcContext * ctx, const char * path, double * output, int * sign1) {
+    struct checkpointHeader header;
+    struct checkpointRecord * records;
+    int functionsToTest[TOTAL_NUMBER_OF_FUNCTIONS];
+    if (readCheckpoint(path, &header, &records) < 0) return -1;
+    if (header.polynOrder != ctx->polynOrder || header.bins != ctx->data.bins || header.dataHash != hashData(&ctx->data)
+        || (header.optimizer != DC_OPTIMIZER_LATTICE && header.optimizer != DC_OPTIMIZER_LBFGS)
+        || header.shardCount < 1 || header.shardIndex < 0 || header.shardIndex >= header.shardCount) {
+        free(records);
+        return -1;
+    }
+    for (int i = 0; i < TOTAL_NUMBER_OF_FUNCTIONS; ++i)
+        functionsToTest[i] = header.functionsToTest[i];
+    *sign1 = header.sign1;
+    int resulting = fitTasks(ctx, output, sign1, header.sign2, functionsToTest, header.optimizer, header.shardIndex, header.shardCount,
+                             records, header.tasksNumber);
+    free(records);
+    return resulting;
+}
+
+int dcMergeShards(const char * const * paths, int count, double * output, int * sign1, double * submax) {
+    if (count < 1) return -1;
+    struct checkpointHeader first, header;
+    struct checkpointRecord ** records = calloc(count, sizeof(struct checkpointRecord *));
+    struct checkpointRecord * listed = calloc(TOTAL_NUMBER_OF_FUNCTIONS * MAX_SIGN_PATTERNS, sizeof(struct checkpointRecord));
+    int functionsToTest[TOTAL_NUMBER_OF_FUNCTIONS];
+    int resulting = records && listed ? 0 : -1;
+    /* the shards must be of one fit, each of them once, and their fits must have finished */
+    for (int i = 0; !resulting && i < count; ++i) {
+        struct checkpointRecord * shard;
+        if (readCheckpoint(paths[i], &header, &shard) < 0) {
+            resulting = -1;
+            break;
+        }
+        if (!i) first = header;
+        if (header.shardCount != count || header.shardIndex < 0 || header.shardIndex >= count || records[header.shardIndex]
+            || header.polynOrder != first.polynOrder || header.optimizer != first.optimizer || header.sign1 != first.sign1
+            || header.sign2 != first.sign2 || memcmp(header.functionsToTest, first.functionsToTest, sizeof(first.functionsToTest))
+            || header.bins != first.bins || header.dataHash != first.dataHash || header.polynOrder < 2 || header.polynOrder > 7) {
+            free(shard);
+            resulting = -1;
+            break;
+        }
+        records[header.shardIndex] = shard;
+        for (int j = 0; j < TOTAL_NUMBER_OF_FUNCTIONS; ++j)
+            functionsToTest[j] = header.functionsToTest[j];
+        if (listFits(header.polynOrder, header.sign1, header.sign2, functionsToTest, header.shardIndex, count, listed) != header.tasksNumber)
+            resulting = -1;
+        for (int j = 0; !resulting && j < header.tasksNumber; ++j) {
+            if (shard[j].func != listed[j].func || shard[j].signs != listed[j].signs) resulting = -1;
+            else if (shard[j].status != TASK_DONE) resulting = -2;
+        }
+    }
+    if (!resulting) {
+        double finalResults[STOP_FUNCTION][9];
+        unsigned char finalSigns[STOP_FUNCTION];
+        for (int i = 0; i < STOP_FUNCTION; ++i)
+            finalResults[i][8] = -1e100;
+        int listedNumber = listFits(first.polynOrder, first.sign1, first.sign2, functionsToTest, 0, 1, listed);
+        /* the fit at the position i of the list is the fit i / count of the shard i % count */
+        for (int i = 0; i < listedNumber; ++i) {
+            const struct checkpointRecord * record = &records[i % count][i / count];
+            mergeFit(record->func, (unsigned char) record->signs, record->output, first.sign1, finalResults, finalSigns);
+        }
+        resulting = bestFunction(functionsToTest, finalResults);
+        if (resulting >= 0) {
+            for (int i = 0; i < 9; ++i) output[i] = finalResults[resulting][i];
+            *sign1 = (int) finalSigns[resulting];
+            *submax = first.submaxAge;
+        }
+    }
+    for (int i = 0; records && i < count; ++i)
+        free(records[i]);
+    free(records);
+    free(listed);
+    return resulting;
+}
+
+/* The fitted curve at each age with the polynomial in Horner's scheme and the sigmoid of the kernels of the fits.
+Where the polynomial is not positive, the probability is the limit of the sigmoid there: the floor, or 0 for the
+functions without the floor and ceiling. The fits never end there, but the coefficients they report are dropped
+when they do not change the curve at the age 80, which may leave, e.g., a flat curve at the floor with no
+polynomial */
+int dcEvaluate(int func, const double * coefficients, const double * ages, const int * outcomes, int length, double * probabilities, double * logLikelihoods) {
+    if (func < 0 || func >= TOTAL_NUMBER_OF_FUNCTIONS || length < 0 || (logLikelihoods && !outcomes)) return -1;
+    const int floorAndCeiling = func % 2, link = func / 2, degree = floorAndCeiling ? 5 : 7;
+    const double * c = floorAndCeiling ? coefficients + 2 : coefficients;
+    double scale = floorAndCeiling ? 0.5 - coefficients[1] : 0.5;
+    for (int i = 0; i < length; ++i) {
+        double result = c[degree];
+        for (int k = degree - 1; k >= 0; --k)
+            result = result * ages[i] + c[k];
+        double probability = result > 0.0 ? scalarLink(link, result) * scale + 0.5 : 0.5 - scale;
+        if (floorAndCeiling) probability = probability - coefficients[1] + coefficients[0];
+        if (probabilities) probabilities[i] = probability;
+        if (logLikelihoods)
+            logLikelihoods[i] = outcomes[i] ? logVerified(probability) : logVerified(1.0 - probability);
+    }
+    return 0;
+}
+
+/* The bootstrap of a fit. Resampling the rows with replacement is approximated by the Poisson bootstrap: each row
+is taken a Poisson(1) number of times, so the deaths and the survivors of a bin of distinct age are Poisson counts
+with their original numbers as the means, and a replicate is the same bins with new weights. Each replicate draws
+from its own xoshiro256** generator seeded by splitmix64 from the seed and its number, so that its counts, and
+therefore its fit, do not depend on the threads or on the order in which the replicates run */
+static uint64_t splitmix64(uint64_t * state) {
+    uint64_t z = (* state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static uint64_t rotateLeft(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+}
+
+static uint64_t xoshiro256(uint64_t * s) {
+    uint64_t result = rotateLeft(s[1] * 5, 7) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotateLeft(s[3], 45);
+    return result;
+}
+
+/* uniform on [0, 1) with 53 random bits */
+static double uniformDraw(uint64_t * s) {
+    return (xoshiro256(s) >> 11) * 0x1.0p-53;
+}
+
+/* Hormann's transformed rejection with squeeze (PTRS) for the large means, whose cost does not grow with the mean,
+and the inversion by multiplying uniforms for the small ones */
+/* log(k!) of the non-negative integral k, from the exact factorials below 10 and the Stirling series above, which is
+within 2e-12 of it there; unlike lgamma, it writes no global sign, so the replicates may be drawn from any thread */
+static double logFactorial(double k) {
+    if (k < 10.0) {
+        double factorial = 1.0;
+        for (double i = 2.0; i <= k; i += 1.0)
+            factorial *= i;
+        return log(factorial);
+    }
+    double n = k + 1.0, inverseSquare = 1.0 / (n * n);
+    return (n - 0.5) * log(n) - n + 0.918938533204672742 + (1.0 / 12.0 - (1.0 / 360.0 - inverseSquare / 1260.0) * inverseSquare) / n;
+}
+
+static double poissonDraw(uint64_t * s, double mean) {
+    if (mean <= 0.0) return 0.0;
+    if (mean < POISSON_PTRS_MIN) {
+        double limit = exp(-mean), product = uniformDraw(s), count = 0.0;
+        while (product > limit) {
+            product *= uniformDraw(s);
+            count += 1.0;
+        }
+        return count;
+    }
+    double root = sqrt(mean), logMean = log(mean);
+    double b = 0.931 + 2.53 * root;
+    double a = -0.059 + 0.02483 * b;
+    double inverseAlpha = 1.1239 + 1.1328 / (b - 3.4);
+    double vr = 0.9277 - 3.6224 / (b - 2.0);
+    while (1) {
+        double u = uniformDraw(s) - 0.5;
+        double v = uniformDraw(s);
+        double us = 0.5 - fabs(u);
+        double k = floor((2.0 * a / us + b) * u + mean + 0.43);
+        if (us >= 0.07 && v <= vr) return k;
+        if (k < 0.0 || (us < 0.013 && v > us)) continue;
+        if (log(v) + log(inverseAlpha) - log(a / (us * us) + b) <= -mean + k * logMean - logFactorial(k)) return k;
+    }
+}
+
+static void replicateDestroy(dcContext * copy) {
+    if (!copy) return;
+    free(copy->data.deaths);
+    free(copy->data.survivors);
+    free(copy->data.prunedAge);
+    free(copy->data.prunedDeaths);
+    free(copy->data.prunedSurvivors);
+    free(copy);
+}
+
+/* the context of a replicate shares the ages and the settings of the context of the fit; the replicates are
+fitted quietly and write no checkpoints */
+static dcContext * replicateCreate(const dcContext * ctx, uint64_t seed, int replicate) {
+    dcContext * copy = calloc(1, sizeof(dcContext));
+    if (!copy) return NULL;
+    copy->data.bins = ctx->data.bins;
+    copy->data.binsPadded = ctx->data.binsPadded;
+    copy->data.age = ctx->data.age;
+    copy->data.deaths = calloc(ctx->data.binsPadded + 1, sizeof(double));
+    copy->data.survivors = calloc(ctx->data.binsPadded + 1, sizeof(double));
+    if (!copy->data.deaths || !copy->data.survivors) {
+        free(copy->data.deaths);
+        free(copy->data.survivors);
+        free(copy);
+        return NULL;
+    }
+    copy->polynOrder = ctx->polynOrder;
+    copy->order = ctx->order;
+    copy->start = ctx->start;
+    copy->skip = ctx->skip;
+    copy->threads = ctx->threads;
+    copy->optimizer = ctx->optimizer;
+    copy->cancelFlag = ctx->cancelFlag;
+    copy->stopFile = ctx->stopFile;
+    copy->shardCount = 1;
+    copy->noPruning = ctx->noPruning;
+    copy->noCache = ctx->noCache;
+    uint64_t state = seed + (uint64_t) replicate * 0x632be59bd9b4e019ULL, s[4];
+    for (int i = 0; i < 4; ++i)
+        s[i] = splitmix64(&state);
+    for (int i = 0; i < ctx->data.bins; ++i) {
+        copy->data.deaths[i] = poissonDraw(s, ctx->data.deaths[i]);
+        copy->data.survivors[i] = poissonDraw(s, ctx->data.survivors[i]);
+    }
+    /* the resampled counts change the magnitudes of the bins, so the replicate has its own pruned copy */
+    if (orderBins(&copy->data) < 0) {
+        replicateDestroy(copy);
+        return NULL;
+    }
+    return copy;
+}
+
+int dcBootstrap(dcContext * ctx, int func, int sign1, const double * output, int replicates, unsigned long long seed,
+                const double * ages, int agesLength, const double * levels, int levelsLength, double * bands, double * coefficients) {
+    if (func < 0 || func >= TOTAL_NUMBER_OF_FUNCTIONS || sign1 < 0 || sign1 >= MAX_SIGN_PATTERNS || replicates < 1
+        || agesLength < 0 || levelsLength < 0) return -1;
+    for (int i = 0; i < levelsLength; ++i)
+        if (!(levels[i] >= 0.0 && levels[i] <= 1.0)) return -1;
+    int functionsToTest[TOTAL_NUMBER_OF_FUNCTIONS] = {0};
+    functionsToTest[func] = 1;
+    /* every replicate goes on from the best fit as from a checkpoint taken after its first step, so it only climbs
+    from there; the coefficients dropped from the report start from the least power of the lattice */
+    struct checkpointRecord warmStart;
+    memset(&warmStart, 0, sizeof(warmStart));
+    warmStart.func = func;
+    warmStart.signs = sign1;
+    warmStart.status = TASK_RUNNING;
+    warmStart.result = warmStart.resultPrev = output[8];
+    for (int i = 0; i < 8; ++i)
+        warmStart.origin[i] = output[i] ? log10(fabs(output[i])) : -300.0;
+    double * fits = malloc((size_t) replicates * 9 * sizeof(double));
+    double * curves = malloc(((size_t) replicates * agesLength + 1) * sizeof(double));
+    struct cohortFits * cohorts = calloc(BOOTSTRAP_ROUND, sizeof(struct cohortFits));
+    dcContext ** copies = calloc(BOOTSTRAP_ROUND, sizeof(dcContext *));
+    int done = fits && curves && cohorts && copies ? 0 : -1, stopped = 0;
+    long long evaluations = 0, abandoned = 0, cacheLookups = 0, cacheHits = 0;
+    for (int round = 0; done == round && round < replicates; round += BOOTSTRAP_ROUND) {
+        int count = replicates - round < BOOTSTRAP_ROUND ? replicates - round : BOOTSTRAP_ROUND, created = 0;
+        while (created < count && (copies[created] = replicateCreate(ctx, seed, round + created))
+               && cohortCreate(&cohorts[created], copies[created], -1, sign1, 1, functionsToTest, ctx->optimizer, 0, 1, &warmStart, 1) == 0)
+            ++created;
+        struct workerPool pool;
+        int ran = created == count && runCohorts(&pool, cohorts, count) == 0;
+        if (!ran) {
+            for (int i = 0; i < created; ++i)
+                cohortFree(&cohorts[i]);
+            done = -1;
+        }
+        /* the replicates are finished as the fits of dcFit are, which removes the stop signal file, and
+        counted up to the first one stopped before it finished */
+        for (int i = 0; ran && i < created; ++i) {
+            int finished = cohorts[i].records[0].status == TASK_DONE, replicateSign = sign1;
+            double replicateOutput[9];
+            stopped |= atomic_load(&cohorts[i].cancelled);
+            if (cohortFinish(&cohorts[i], &pool, replicateOutput, &replicateSign) < 0)
+                done = -1;
+            evaluations += atomic_load(&copies[i]->evaluations);
+            abandoned += atomic_load(&copies[i]->abandoned);
+            cacheLookups += atomic_load(&copies[i]->cacheLookups);
+            cacheHits += atomic_load(&copies[i]->cacheHits);
+            if (done == round + i && finished) {
+                for (int j = 0; j < 9; ++j)
+                    fits[9 * done + j] = replicateOutput[j];
+                dcEvaluate(func, replicateOutput, ages, NULL, agesLength, curves + (size_t) done * agesLength, NULL);
+                ++done;
+            }
+        }
+        for (int i = 0; i < count; ++i) {
+            replicateDestroy(copies[i]);
+            copies[i] = NULL;
+        }
+        if (done >= 0)
+            message(ctx, "I have fitted %d of %d bootstrap replicates\n", done, replicates);
+    }
+    atomic_store(&ctx->evaluations, evaluations);
+    atomic_store(&ctx->abandoned, abandoned);
+    atomic_store(&ctx->cacheLookups, cacheLookups);
+    atomic_store(&ctx->cacheHits, cacheHits);
+    if (done > 0) {
+        if (coefficients)
+            memcpy(coefficients, fits, (size_t) done * 9 * sizeof(double));
+        /* the percentiles interpolate linearly between the order statistics of the replicates at each age */
+        double * column = fits;     // no longer needed, and at least as long as a column
+        for (int j = 0; j < agesLength; ++j) {
+            for (int i = 0; i < done; ++i)
+                column[i] = curves[(size_t) i * agesLength + j];
+            qsort(column, done, sizeof(double), compareAges);
+            for (int l = 0; l < levelsLength; ++l) {
+                double position = levels[l] * (done - 1);
+                int below = (int) floor(position);
+                int above = below + 1 < done ? below + 1 : below;
+                bands[(size_t) l * agesLength + j] = column[below] + (column[above] - column[below]) * (position - below);
+            }
+        }
+    }
+    if (stopped && done >= 0)
+        message(ctx, "I have received the signal to stop. The bootstrap has stopped after %d of %d replicates\n", done, replicates);
+    free(fits);
+    free(curves);
+    free(cohorts);
+    free(copies);
+    return done;
+}
+
+/* the function that needs to be called from the Python (wrapper) script of the versions before the context interface */
+int fitFunction(double * ages, int * the_outcomes, int length, double * output, int * sign1, int sign2, int * functionsToTest, int polyn_order) {
+    dcContext * ctx = dcCreate(ages, the_outcomes, length, polyn_order);
+    if (!ctx) return -1;
+    dcSetThreads(ctx, atomic_load(&threadsNumber_g));
+    dcSetOptimizer(ctx, atomic_load(&optimizer_g));
+    if (dcSetStopFile(ctx, "stop.txt") < 0) {
+        dcDestroy(ctx);
+        return -1;
+    }
+    int resulting = dcFit(ctx, output, sign1, sign2, functionsToTest);
+    dcDestroy(ctx);
+    return resulting;
+}
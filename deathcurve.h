@@ -0,0 +1,186 @@
+/*
+Interface of the shared C library deathcurve.c.
+
+A context holds one cohort, compressed into bins of distinct ages,
+and the polynomial order to fit. The fits keep all their state in the
+context and on their own stacks, so several contexts may be created
+and fitted at once from different threads of one process, and one
+context may be fitted several times (e.g., with different functions or
+signs). A context must not be destroyed while it is being fitted.
+
+Copyright (C) 2020  Alexander Yuryatin
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef DEATHCURVE_H
+#define DEATHCURVE_H
+
+#include <stdatomic.h>
+
+typedef struct dcContext dcContext;
+
+#define DC_OPTIMIZER_LATTICE 0  // the hill climbing on the lattice of the powers of the coefficients with the precisions from 1 to 0.0001 (the default)
+#define DC_OPTIMIZER_LBFGS 1    // the hill climbing on the lattice with the precision 1 followed by L-BFGS with analytic gradients in the same powers
+
+/* Copies the ages and outcomes (non-zero means death) into a new context for the polynomial order from 2 to 7.
+Returns NULL if the order is out of range or the memory could not be allocated */
+dcContext * dcCreate(const double * ages, const int * outcomes, int length, int polyn_order);
+
+/* Sets the number of threads of the following fits of the context; 0 (the default) means one thread per online CPU core */
+void dcSetThreads(dcContext * ctx, int threads);
+
+/* Sets the optimizer of the following fits of the context. Returns -1 for an unknown optimizer */
+int dcSetOptimizer(dcContext * ctx, int optimizer);
+
+/* What the progress callback receives after a step of the hill climbing of one function with one set of signs */
+typedef struct dcProgress {
+    int function;                   // the number of the function whose step has just ended
+    int signs;                      // its signs coded as *sign1 of dcFit
+    double precision;               // its current precision from 1 to 0.0001
+    double ml;                      // its ML estimate so far
+    long long evaluations;          // the grid points evaluated by all the fits of the call so far
+    double evaluationsPerSecond;    // since the previous report
+    int fitsDone, fitsTotal;        // the functions with their sets of signs fitted so far and in all
+} dcProgress;
+
+typedef void (*dcProgressCallback)(const dcProgress * progress, void * userData);
+
+/* Makes the following fits of the context call back at most every interval seconds. The callback is called from
+whichever thread of the fit has just ended a step, never from two threads at once, and should return quickly.
+NULL (the default) turns the callback off */
+void dcSetProgress(dcContext * ctx, dcProgressCallback callback, void * userData, double interval);
+
+/* Makes the following fits of the context stop after their current steps once *flag, which the caller may set
+from any thread, is non-zero; dcFit then reports the best results so far. NULL (the default) turns it off */
+void dcSetCancelFlag(dcContext * ctx, const atomic_int * flag);
+
+/* Makes the following fits of the context also stop when a file appears at path, which they look for after each
+step at the cost of a system call, and delete the file. NULL (the default) turns it off; fitFunction and the
+Python wrapper look for "stop.txt". Returns -1 if the memory could not be allocated */
+int dcSetStopFile(dcContext * ctx, const char * path);
+
+/* Turns the progress messages and the summary of the following fits of the context on the standard output,
+which is their default sink, off (0) or on again */
+void dcSetConsole(dcContext * ctx, int enabled);
+
+/* Fits the functions flagged in functionsToTest[10] with the signs from *sign1 up to all negative (sign2 == 0)
+or with the signs *sign1 only (sign2 != 0). Writes the eight coefficients and the ML estimate of the best
+function into output[9] and its signs into *sign1, and returns the number of that function, or -1 if the
+memory could not be allocated */
+int dcFit(dcContext * ctx, double * output, int * sign1, int sign2, const int * functionsToTest);
+
+/* Fits count contexts at once on one worker pool with the threads set for the first of them: the fits of the functions
+with their signs of all the contexts are queued one context after another, so that no core waits for the last fits of a
+context while others are left. Each context is fitted as dcFit would fit it with its own optimizer, shard, checkpoint,
+progress callback, which may be called for different contexts at once, and stop signals, and with the signs from
+sign1[i] and the functions of sign2 and functionsToTest. Writes the results of the context i into outputs[9 * i] to
+outputs[9 * i + 8], its signs into sign1[i], and its best function into functions[i]. Returns -1 if the memory could
+not be allocated, or 0. The checkpoint of a context of an interrupted batch is resumed with dcResume */
+int dcFitBatch(dcContext * const * contexts, int count, double * outputs, int * sign1, int sign2, const int * functionsToTest, int * functions);
+
+/* Estimates the uncertainty of the fit that dcFit returned for the context: func, its signs *sign1, and its output[9].
+Each of the replicates reweights the bins of distinct ages with Poisson counts of their deaths and survivors (the
+Poisson bootstrap), which the seed and the number of the replicate determine, and refits the function with the same
+signs from the coefficients of the fit, all on one worker pool with the threads and the optimizer of the context. Writes
+the levels[levelsLength] (from 0 to 1, e.g., 0.025 and 0.975) percentiles of the probabilities at ages[agesLength] over
+the replicates into bands[levelsLength * agesLength], a row per level, and, unless coefficients is NULL, the eight
+coefficients and the ML estimate of each replicate into coefficients[9 * replicates]. The results are the same for a
+seed with any number of threads. A cancel flag or stop signal file of the context stops the replicates, and the stop
+signal file is removed as dcFit removes it; returns the number of replicates fitted, which the bands are of, or -1 if
+the arguments are invalid or the memory could not be allocated */
+int dcBootstrap(dcContext * ctx, int func, int sign1, const double * output, int replicates, unsigned long long seed,
+                const double * ages, int agesLength, const double * levels, int levelsLength, double * bands, double * coefficients);
+
+/* Makes the following fits of the context write a checkpoint to the file at path at most every interval seconds,
+when a step of the hill climbing ends, and once more when the fit finishes or is stopped. The file is replaced
+at once, so that a process killed while writing it leaves the previous checkpoint. NULL turns the checkpoints off.
+Returns -1 if the memory could not be allocated */
+int dcSetCheckpoint(dcContext * ctx, const char * path, double interval);
+
+/* Returns the polynomial order of the fit saved in the checkpoint file, with which the context to resume it is
+created, or -1 if the file is not a checkpoint */
+int dcCheckpointOrder(const char * path);
+
+/* Returns the number of the shards of the fit saved in the checkpoint file (1 if it is not sharded, see dcSetShard),
+or -1 if the file is not a checkpoint */
+int dcCheckpointShards(const char * path);
+
+/* Goes on with the fit saved in the checkpoint file with its signs, functions, and optimizer: the finished fits of
+the functions with their signs are taken from the checkpoint, and the others go on from their latest steps, so that
+the results are the same as if the fit had not been interrupted. The context must hold the same cohort and order.
+Writes the checkpoints set with dcSetCheckpoint, which may be the same file. Returns what dcFit returns, or -1
+if the checkpoint could not be read or is not of this cohort */
+int dcResume(dcContext * ctx, const char * path, double * output, int * sign1);
+
+/* Makes the following fits of the context run only the fits of the functions with their signs whose positions in the
+list of dcFit, in the order they used to run one after another, modulo count are index, so that count processes, e.g.,
+on different computers, share the list. The checkpoint set with dcSetCheckpoint is the result file of the shard,
+which dcMergeShards reads, and dcFit reports the best of its fits only. A shard is resumed with dcResume like any
+fit. Count 1 (the default) runs the whole list. Returns -1 if the index is not from 0 to count - 1 */
+int dcSetShard(dcContext * ctx, int index, int count);
+
+/* Picks the best function from the result files of all the count shards of one fit, in any order, exactly as dcFit
+would have picked it from the whole list, without the cohort. Writes the eight coefficients and the ML estimate
+into output[9], the signs into *sign1, and the second largest age of the cohort, which ends the plots of the
+Python wrapper, into *submaxAge, and returns the number of the function. Returns -1 if a file could not be read
+or the files are not the count shards of one fit, and -2 if a fit of a shard has not finished (it can be resumed) */
+int dcMergeShards(const char * const * paths, int count, double * output, int * sign1, double * submaxAge);
+
+/* The counters of the last fit of the context. A grid point is abandoned when its log-likelihood, summed over
+part of the bins, falls below the best point of its step, which it then cannot beat. The caches hold the points
+of the earlier steps of each function and set of signs at the current precision */
+typedef struct dcCounters {
+    long long evaluations;          // the grid points whose log-likelihood was computed
+    long long abandoned;            // of them, those abandoned before all the bins were summed
+    long long cacheLookups;         // the grid points looked up in the caches of the points already evaluated at the same precision
+    long long cacheHits;            // of them, those taken from the cache instead of being evaluated
+    long long cacheBytes;           // the memory of the largest cache of one function with one set of signs
+} dcCounters;
+
+void dcGetCounters(const dcContext * ctx, dcCounters * counters);
+
+/* The counters and timers of the last fit of the context, which the library collects only when it is compiled with
+-DDEATHCURVE_PROFILE; otherwise the contexts do not hold them, and the profile is all zero with enabled 0, which
+tells that profiling is unavailable. It must not be called while the context is being fitted. A fit resumed from a
+checkpoint counts only the work done after it was resumed */
+typedef struct dcProfile {
+    int enabled;                    // 1 if the library was compiled with -DDEATHCURVE_PROFILE
+    long long steps[5];             // the steps of the hill climbing at the precisions from 1 to 0.0001
+    long long backoffs;             // the returns to a coarser precision because slope ascending was too slow
+    long long lbfgsIterations;
+    double wallSeconds;             // the whole fit
+    double computeSeconds;          // the thread-seconds spent evaluating the grid points of the steps
+    double spawnSeconds, joinSeconds;   // creating and joining the threads of the pool
+    double fitSeconds[10][256];     // the wall time of each function with each set of signs coded as *sign1, 0 if it was not fitted
+} dcProfile;
+
+void dcGetProfile(const dcContext * ctx, dcProfile * profile);
+
+void dcDestroy(dcContext * ctx);
+
+/* Evaluates the function func with the eight coefficients that dcFit writes into output (with their signs) at the length
+ages: writes the probabilities of death into probabilities and, unless logLikelihoods is NULL, the log-likelihoods of the
+outcomes (non-zero means death) as the fits compute them into logLikelihoods. Either array may be NULL, and outcomes may
+be NULL without logLikelihoods. Needs no context and may be called from any thread. Returns -1 for an unknown function,
+or 0 */
+int dcEvaluate(int func, const double * coefficients, const double * ages, const int * outcomes, int length, double * probabilities, double * logLikelihoods);
+
+/* The interface of the versions before the contexts, which creates and destroys a context for each call */
+void setThreadsNumber(int threads);
+int setOptimizer(int optimizer);
+int fitFunction(double * ages, int * the_outcomes, int length, double * output, int * sign1, int sign2, int * functionsToTest, int polyn_order);
+
+#endif
@@ -79,10 +79,11 @@ import numpy as np
 import pandas as pd
 from scipy.special import erf
 from math import ceil
-from ctypes import cdll, c_void_p, c_int
+from ctypes import cdll, c_void_p, c_int, c_char_p, c_double, c_longlong, c_ulonglong, Structure, POINTER, CFUNCTYPE, addressof, byref
+from threading import Lock
 import matplotlib.pyplot as plt
 from os.path import abspath
-from typing import Tuple
+from typing import Tuple, Callable
 
 
 class bestFit():
@@ -253,7 +254,42 @@ class bestFit():
                         'WolframAlpha\n\tplot |  (0.5 - {4:e}) * log({2:s})/(1 + abs(log({2:s}))) + 0.5 - {4:e} + {3:e} | x = {6:s} to {7:.0f}\n\n' ]
                         
     def function(self, x) -> float:
-        return self.testFuncs[self.best](self, x)
+        return float(self.predict(np.array([x], dtype=np.float64))[0])
+
+    def _evaluate(self, ages, outcomes = None):
+        # the shared C library evaluates the curve with the same polynomial and sigmoid as the fits
+        age = np.ascontiguousarray(ages, dtype=np.float64).ravel()
+        probabilities = np.empty(age.size, dtype=np.float64)
+        logLikelihoods = None
+        if outcomes is not None:
+            outcome = np.ascontiguousarray(np.asarray(outcomes).ravel() != 0, dtype=np.intc)
+            if outcome.size != age.size:
+                raise ValueError('the ages and the outcomes should be of the same length')
+            logLikelihoods = np.empty(age.size, dtype=np.float64)
+        _library().dcEvaluate(self.best, c_void_p(self.parameters.ctypes.data), c_void_p(age.ctypes.data),
+                              c_void_p(outcome.ctypes.data) if outcomes is not None else None, age.size,
+                              c_void_p(probabilities.ctypes.data), c_void_p(logLikelihoods.ctypes.data) if outcomes is not None else None)
+        return probabilities, logLikelihoods
+
+    def predict(self, ages) -> np.ndarray:
+        """
+        predict(ages) -> np.ndarray
+
+        Returns the probabilities of death at the ages (a number, a list,
+        a NumPy array or a pandas Series) from the fitted function, which
+        the shared C library computes for all of them at once
+        """
+        return self._evaluate(ages)[0]
+
+    def logLikelihoods(self, ages, outcomes) -> np.ndarray:
+        """
+        logLikelihoods(ages, outcomes) -> np.ndarray
+
+        Returns the log-likelihood of each outcome (non-zero means death)
+        at its age, as the fits compute them, e.g., to score another cohort
+        with the fitted function
+        """
+        return self._evaluate(ages, outcomes)[1]
         
     def reportModel(self) -> None:
         text_output = '\nBest fit is:' + self.output()
@@ -266,7 +302,7 @@ class bestFit():
     def plotModel(self) -> None:
         # Plotting the graph
         x = np.arange(0.01 if self.b0 <= 0.0 else self.b0 + 0.01, self.submaxAge, 0.01)  # the scarcity of the cases in the upper end of the age range makes the tail very volitile, so it is trimmed a bit on the plot
-        y = np.array([100.0 * self.function(i) for i in x])
+        y = 100.0 * self.predict(x)
 
         fig, subpl = plt.subplots( 1, 1, figsize=(7,6))
         fig.suptitle('Age-adjusted COVID-19 mortality', fontsize=16)
@@ -285,7 +321,7 @@ class bestFit():
         fig.savefig("result.png")
         plt.show()
                         
-    def __init__(self, parameters: np.ndarray, functionNumber: int, sign: int, submaxAge: float):
+    def __init__(self, parameters: np.ndarray, functionNumber: int, sign: int, submaxAge: float, polynomialOrder: int = 5):
         self.best = functionNumber
         if functionNumber % 2:
             self.b0 = parameters[2]
@@ -307,13 +343,129 @@ class bestFit():
             self.b6 = parameters[6]
             self.b7 = parameters[7]
             self.params = tuple(parameters[:8])
+        self.parameters = np.ascontiguousarray(parameters[:8], dtype=np.float64)     # in the order of the shared C library, which evaluates the function
         self.ml = parameters[8]
         self.signs = sign
         self.bestName = bestFit.testFuncsNames[functionNumber]
         self.outputText = bestFit.testFuncsReports[functionNumber]
         self.submaxAge = submaxAge
+        self.polynomialOrder = polynomialOrder      # of the fit, which bootstrap() refits the replicates with; 5, the default order of the fits, if not given
+        self.profile = {}       # the counters and timers of the fit, which fitFunctionWrapper() fills in
         
         
+class cancelFlag():
+    """
+    The flag that stops the fits of fitFunctionWrapper() it is passed to
+    after their current steps once cancel() is called from any thread;
+    the fits then report the best results so far
+    """
+    def __init__(self):
+        self.flag = c_int(0)
+    
+    def cancel(self):
+        self.flag.value = 1
+    
+    def cancelled(self) -> bool:
+        return self.flag.value != 0
+
+
+class _dcProgress(Structure):
+    _fields_ = [ ('function', c_int), ('signs', c_int), ('precision', c_double), ('ml', c_double),
+                 ('evaluations', c_longlong), ('evaluationsPerSecond', c_double), ('fitsDone', c_int), ('fitsTotal', c_int) ]    # dcProgress in deathcurve.h
+
+
+_dcProgressCallback = CFUNCTYPE(None, POINTER(_dcProgress), c_void_p)
+
+
+class _dcCounters(Structure):
+    _fields_ = [ ('evaluations', c_longlong), ('abandoned', c_longlong), ('cacheLookups', c_longlong), ('cacheHits', c_longlong), ('cacheBytes', c_longlong) ]     # dcCounters in deathcurve.h
+
+
+class _dcProfile(Structure):
+    _fields_ = [ ('enabled', c_int), ('steps', c_longlong * 5), ('backoffs', c_longlong), ('lbfgsIterations', c_longlong),
+                 ('wallSeconds', c_double), ('computeSeconds', c_double), ('spawnSeconds', c_double), ('joinSeconds', c_double),
+                 ('fitSeconds', (c_double * 256) * 10) ]     # dcProfile in deathcurve.h
+
+
+def _profile(clib, context) -> dict:
+    """
+    Collects the counters of the last fit of the context and, if the
+    shared C library was compiled with -DDEATHCURVE_PROFILE, its timers,
+    with the wall time of each function and set of signs under the keys
+    (function, signs) as in the reports, e.g., (0, '+-++++++')
+    """
+    counters = _dcCounters()
+    clib.dcGetCounters(context, byref(counters))
+    result = { name: getattr(counters, name) for name, _ in _dcCounters._fields_ }
+    profile = _dcProfile()
+    clib.dcGetProfile(context, byref(profile))
+    result['profiled'] = bool(profile.enabled)
+    if profile.enabled:
+        result['steps'] = tuple(profile.steps)
+        for name in ('backoffs', 'lbfgsIterations', 'wallSeconds', 'computeSeconds', 'spawnSeconds', 'joinSeconds'):
+            result[name] = getattr(profile, name)
+        result['fitSeconds'] = { (function, ''.join('-' if signs & 2 ** i else '+' for i in range(8))): profile.fitSeconds[function][signs]
+                                 for function in range(10) for signs in range(256) if profile.fitSeconds[function][signs] }
+    return result
+
+
+_clib = None
+_clibLock = Lock()
+_optimizers = { 'lattice': 0, 'lbfgs': 1 }     # DC_OPTIMIZER_LATTICE and DC_OPTIMIZER_LBFGS in deathcurve.h
+
+
+def _library():
+    """
+    Loads the shared C library once per process and declares its
+    interface. The fits keep their state in the contexts they are given,
+    so the loaded library may be shared by any number of Python threads
+    """
+    global _clib
+    with _clibLock:
+        if _clib is None:
+            clib = cdll.LoadLibrary(abspath('libdeathcurve.so'))      # loading the compiled binary shared C library, which should be located in the same directory as this Python script; absolute path is more important for Linux — not necessary for MacOS
+            clib.dcCreate.argtypes = [ c_void_p, c_void_p, c_int, c_int ]
+            clib.dcCreate.restype = c_void_p
+            clib.dcSetThreads.argtypes = [ c_void_p, c_int ]
+            clib.dcSetThreads.restype = None
+            clib.dcSetOptimizer.argtypes = [ c_void_p, c_int ]
+            clib.dcSetOptimizer.restype = c_int
+            clib.dcFit.argtypes = [ c_void_p, c_void_p, c_void_p, c_int, c_void_p ]
+            clib.dcFit.restype = c_int
+            clib.dcFitBatch.argtypes = [ POINTER(c_void_p), c_int, c_void_p, c_void_p, c_int, c_void_p, c_void_p ]
+            clib.dcFitBatch.restype = c_int
+            clib.dcSetCheckpoint.argtypes = [ c_void_p, c_char_p, c_double ]
+            clib.dcSetCheckpoint.restype = c_int
+            clib.dcCheckpointOrder.argtypes = [ c_char_p ]
+            clib.dcCheckpointOrder.restype = c_int
+            clib.dcSetShard.argtypes = [ c_void_p, c_int, c_int ]
+            clib.dcSetShard.restype = c_int
+            clib.dcMergeShards.argtypes = [ POINTER(c_char_p), c_int, c_void_p, c_void_p, POINTER(c_double) ]
+            clib.dcMergeShards.restype = c_int
+            clib.dcResume.argtypes = [ c_void_p, c_char_p, c_void_p, c_void_p ]
+            clib.dcResume.restype = c_int
+            clib.dcSetProgress.argtypes = [ c_void_p, _dcProgressCallback, c_void_p, c_double ]
+            clib.dcSetProgress.restype = None
+            clib.dcSetCancelFlag.argtypes = [ c_void_p, c_void_p ]
+            clib.dcSetCancelFlag.restype = None
+            clib.dcSetStopFile.argtypes = [ c_void_p, c_char_p ]
+            clib.dcSetStopFile.restype = c_int
+            clib.dcSetConsole.argtypes = [ c_void_p, c_int ]
+            clib.dcSetConsole.restype = None
+            clib.dcGetCounters.argtypes = [ c_void_p, c_void_p ]
+            clib.dcGetCounters.restype = None
+            clib.dcGetProfile.argtypes = [ c_void_p, c_void_p ]
+            clib.dcGetProfile.restype = None
+            clib.dcDestroy.argtypes = [ c_void_p ]
+            clib.dcDestroy.restype = None
+            clib.dcEvaluate.argtypes = [ c_int, c_void_p, c_void_p, c_void_p, c_int, c_void_p, c_void_p ]
+            clib.dcEvaluate.restype = c_int
+            clib.dcBootstrap.argtypes = [ c_void_p, c_int, c_int, c_void_p, c_int, c_ulonglong, c_void_p, c_int, c_void_p, c_int, c_void_p, c_void_p ]
+            clib.dcBootstrap.restype = c_int
+            _clib = clib
+    return _clib
+
+
 def _strToSigns(signs: str) -> int:
     result = 0
     for i, letter in enumerate(signs):
@@ -322,14 +474,108 @@ def _strToSigns(signs: str) -> int:
     return result
 
 
-def fitFunctionWrapper(df: pd.DataFrame, signs: str = None, oneSignSet: bool = False, functions: Tuple = tuple(range(len(bestFit.testFuncs))), polynomial_order: int = 5) -> bestFit:
+def _checkArguments(caller: str, signs, functions, polynomial_order, threads, optimizer, checkpointInterval, progress, progressInterval, cancel) -> None:
+    """
+    Checks the arguments that fitFunctionWrapper() and fitBatch() share
+    """
+    if not isinstance(polynomial_order, int):
+        raise TypeError('argument \'polynomial_order\' of the function {} accepts only integers'.format(caller))
+    if polynomial_order > 7 or polynomial_order < 2:
+        raise ValueError('argument \'polynomial_order\' of the function {} accepts only integers from 2 to 7'.format(caller))
+    if not isinstance(threads, int):
+        raise TypeError('argument \'threads\' of the function {} accepts only integers'.format(caller))
+    if threads < 0:
+        raise ValueError('argument \'threads\' of the function {} accepts only non-negative integers'.format(caller))
+    if optimizer not in _optimizers:
+        raise ValueError('argument \'optimizer\' of the function {} accepts only the strings {}'.format(caller, ', '.join('\'{}\''.format(name) for name in _optimizers)))
+    if not isinstance(checkpointInterval, (int, float)):
+        raise TypeError('argument \'checkpointInterval\' of the function {} accepts only numbers'.format(caller))
+    if progress != None and not callable(progress):
+        raise TypeError('argument \'progress\' of the function {} accepts only callables'.format(caller))
+    if not isinstance(progressInterval, (int, float)):
+        raise TypeError('argument \'progressInterval\' of the function {} accepts only numbers'.format(caller))
+    if cancel != None and not isinstance(cancel, cancelFlag):
+        raise TypeError('argument \'cancel\' of the function {} accepts only objects of the class cancelFlag'.format(caller))
+    if signs != None and not isinstance(signs, str):
+        raise TypeError('argument \'signs\' of the function {} accepts only strings'.format(caller))
+    if signs:
+        if len(signs) > 8:
+            raise ValueError('argument \'signs\' of the function {} accepts only strings of the length up to 8 (with \'+\' and \'-\')'.format(caller))
+        for letter in signs:
+            if letter != '+' and letter != '-':
+                raise ValueError('argument \'signs\' of the function {} accepts only strings with \'+\' and \'-\''.format(caller))
+    if not isinstance(functions, Tuple):
+        raise ValueError('argument \'functions\' of the function {} accepts only tuples of integers'.format(caller))
+    for i in functions:
+        if not isinstance(i, int):
+            raise TypeError('argument \'functions\' of the function {} should contain only integers'.format(caller))
+        if i not in range(len(bestFit.testFuncs)):
+            raise ValueError('argument \'functions\' of the function {} should contain only integers between 0 and {} inclusive'.format(caller, len(bestFit.testFuncs)))
+
+
+def _columns(caller: str, df: pd.DataFrame):
+    """
+    Checks the DataFrame of a cohort, names its columns 'age' and
+    'outcome', and returns them as the arrays of the shared C library
+    """
+    if not isinstance(df, pd.DataFrame):
+        raise TypeError('function {} accepts only pandas DataFrames as a first parameter'.format(caller))
+    if df.shape[1] != 2:
+        raise ValueError('function {} accepts as a first parameter pandas DataFrames with only two columns: age and outcome'.format(caller))
+    df.columns = ['age', 'outcome']
+    if 'float' not in df['age'].dtype.__str__() and 'int' not in df['age'].dtype.__str__():
+        raise TypeError('the 1st column in the pandas DataFrame that function {}() accepts may only contain data of the numeric types, not {}'.format(caller, df['age'].dtype.__str__()))
+    if 'float' not in df['outcome'].dtype.__str__() and 'int' not in df['outcome'].dtype.__str__():
+        raise TypeError('the 2nd column in the pandas DataFrame that function {}() accepts may only contain data of the numeric types, not {}'.format(caller, df['outcome'].dtype.__str__()))
+    if any(df['age'] < 0.0) or any(df['age'] > 140.0):
+        raise ValueError('function {} accepts as a first parameter pandas DataFrames with the first column \'age\' with the values between 0.0 and 140.0 only'.format(caller))
+    # when working with these arrays from the shared C library, it is critical for them be continuous in memory
+    return np.ascontiguousarray(df['age'], dtype=np.float64), np.ascontiguousarray(df['outcome'], dtype=np.intc)
+
+
+def _setUp(clib, context, threads, optimizer, checkpoint, checkpointInterval, progress, progressInterval, console, cancel, cohort = None):
+    """
+    Passes the options of a fit to its context and returns the progress
+    callback, which the caller keeps referenced until the fit returns;
+    the progress of a cohort of fitBatch() has the key 'cohort' as well.
+    The fit looks for the file stop.txt after its steps only without a
+    cancelFlag, so that a fit stopped through the flag makes no system
+    calls between its steps
+    """
+    clib.dcSetThreads(context, threads)
+    clib.dcSetOptimizer(context, _optimizers[optimizer])
+    if checkpoint and clib.dcSetCheckpoint(context, checkpoint.encode(), checkpointInterval) < 0:
+        raise MemoryError('the shared C library could not allocate the path of the checkpoint')
+    clib.dcSetConsole(context, int(console))
+    if cancel:
+        clib.dcSetCancelFlag(context, addressof(cancel.flag))
+    elif clib.dcSetStopFile(context, b'stop.txt') < 0:
+        raise MemoryError('the shared C library could not allocate the path of the stop signal file')
+    if not progress:
+        return None
+    def report(state, userData):
+        values = { name: getattr(state.contents, name) for name, _ in _dcProgress._fields_ }
+        if cohort != None:
+            values['cohort'] = cohort
+        progress(values)
+    callback = _dcProgressCallback(report)
+    clib.dcSetProgress(context, callback, None, progressInterval)
+    return callback
+
+
+def fitFunctionWrapper(df: pd.DataFrame, signs: str = None, oneSignSet: bool = False, functions: Tuple = tuple(range(len(bestFit.testFuncs))), polynomial_order: int = 5, threads: int = 0, optimizer: str = 'lattice', checkpoint: str = None, checkpointInterval: float = 600.0, resume: bool = False, progress: Callable = None, progressInterval: float = 1.0, console: bool = True, cancel: cancelFlag = None, shard: Tuple = None) -> bestFit:
     """
     fitFunctionWrapper(df: pd.DataFrame, signs: str = None, oneSignSet:
         bool = False, functions: Tuple = tuple(range(len(bestFit.testFuncs))),
-            polynomial_order: int = 5) -> bestFit
+            polynomial_order: int = 5, threads: int = 0, optimizer: str =
+                'lattice', checkpoint: str = None, checkpointInterval: float =
+                    600.0, resume: bool = False, progress: Callable = None,
+                        progressInterval: float = 1.0, console: bool = True,
+                            cancel: cancelFlag = None, shard: Tuple =
+                                None) -> bestFit
     
     The Python wrapper interface function fitFunctionWrapper() accepts
-    up to five arguments:
+    up to fifteen arguments:
     - a two-column pandas DataFrame (the only mandatory argument) with:
       - the first column 'age' of the numpy numerical data type, e.g.,
         numpy.float64 or numpy.intc (the float datatype allows to
@@ -350,48 +596,66 @@ def fitFunctionWrapper(df: pd.DataFrame, signs: str = None, oneSignSet: bool = F
       8, 9)
     - an integer with the order of the internal polynomial, which can be in
       the range from 2 to 7
+    - an integer with the number of threads the shared C library may use
+      (0, the default, means one thread per online CPU core)
+    - a string with the optimizer: 'lattice' (the default) climbs the
+      lattice of the powers of the coefficients with the precisions from
+      1 to 0.0001, and 'lbfgs' climbs it with the precision 1 only and
+      then continues with the L-BFGS method using analytic gradients,
+      which needs far fewer evaluations of the likelihood
+    - a string with the path of a checkpoint file, which the shared C
+      library rewrites during the fit, so that a fit stopped with the file
+      stop.txt or killed can be resumed (None, the default, writes none)
+    - a float with the least number of seconds between two checkpoints
+      (600 by default); the checkpoint is also written when the fit ends
+    - a boolean argument specifying if you want to resume the fit saved in
+      the checkpoint (True) instead of starting a new one (False, the
+      default). The fit goes on with the signs, functions, polynomial
+      order, and optimizer of the checkpoint, so these arguments are
+      ignored, and the DataFrame must be the same as that of the checkpoint
+    - a callable that receives the progress of the fit as a dictionary with
+      the keys 'function', 'signs', 'precision', 'ml', 'evaluations',
+      'evaluationsPerSecond', 'fitsDone', and 'fitsTotal' (None, the
+      default, reports none); it is called from the threads of the shared
+      C library, one call at a time
+    - a float with the least number of seconds between two calls of the
+      progress callable (1 by default)
+    - a boolean argument specifying if the shared C library prints its
+      progress messages and the summary (True, the default) or not (False)
+    - an object of the class cancelFlag defined in the same wrapper module,
+      whose cancel() method stops the fit from another thread (None, the
+      default, makes the file stop.txt in the working directory stop the
+      fit instead; with a cancelFlag, the file is not looked for)
+    - a tuple of two integers (index, count) that makes this call fit only
+      the shard index from 0 to count - 1 of the functions with their
+      signs, so that count processes or computers share the fit (None, the
+      default, fits all of them); the results of the shard are saved in
+      the checkpoint, which is required, and mergeShards() picks the best
+      fit from the checkpoints of all the shards
 
     It return an object of the class bestFit defined in the same wrapper
-    module.
+    module. Its attribute profile is a dictionary with the counters of the
+    fit and, if the shared C library was compiled with -DDEATHCURVE_PROFILE,
+    its timers (see dcProfile in deathcurve.h).
     
     Be careful: this function treats all "odd" fitted functions as if they
     should have the floor and ceiling and, therefore, assings coefficients
     differently from "even" fitted functions
     """
-    if not isinstance(polynomial_order, int):
-        raise TypeError('argument \'polynomial_order\' of the function fitFunctionWrapper accepts only integers')
-    if polynomial_order > 7 or polynomial_order < 2:
-        raise ValueError('argument \'polynomial_order\' of the function fitFunctionWrapper accepts only integers from 2 to 7')
-    if not isinstance(df, pd.DataFrame):
-        raise TypeError('function fitFunctionWrapper accepts only pandas DataFrames as a first parameter')
-    if df.shape[1] != 2:
-        raise ValueError('function fitFunctionWrapper accepts as a first parameter pandas DataFrames with only two columns: age and outcome')
-    df.columns = ['age', 'outcome']
-    if 'float' not in df['age'].dtype.__str__() and 'int' not in df['age'].dtype.__str__():
-        raise TypeError('the 1st column in the pandas DataFrame that function fitFunctionWrapper() accepts may only contain data of the numeric types, not {}'.format(df['age'].dtype.__str__()))
-    if 'float' not in df['outcome'].dtype.__str__() and 'int' not in df['outcome'].dtype.__str__():
-        raise TypeError('the 2nd column in the pandas DataFrame that function fitFunctionWrapper() accepts may only contain data of the numeric types, not {}'.format(df['outcome'].dtype.__str__()))
-    if any(df['age'] < 0.0) or any(df['age'] > 140.0):
-        raise ValueError('function fitFunctionWrapper accepts as a first parameter pandas DataFrames with the first column \'age\' with the values between 0.0 and 140.0 only')
-    if signs != None and not isinstance(signs, str):
-        raise TypeError('argument \'signs\' of the function fitFunctionWrapper accepts only strings')
-    if signs:
-        if len(signs) > 8:
-            raise ValueError('argument \'signs\' of the function fitFunctionWrapper accepts only strings of the length up to 8 (with \'+\' and \'-\')')
-        for letter in signs:
-            if letter != '+' and letter != '-':
-                raise ValueError('argument \'signs\' of the function fitFunctionWrapper accepts only strings with \'+\' and \'-\'')
-    if not isinstance(functions, Tuple):
-        raise ValueError('argument \'functions\' of the function fitFunctionWrapper accepts only tuples of integers')
-    for i in functions:
-        if not isinstance(i, int):
-            raise TypeError('argument \'functions\' of the function fitFunctionWrapper should contain only integers')
-        if i not in range(len(bestFit.testFuncs)):
-            raise ValueError('argument \'functions\' of the function fitFunctionWrapper should contain only integers between 0 and {} inclusive'.format(len(bestFit.testFuncs)))
+    _checkArguments('fitFunctionWrapper', signs, functions, polynomial_order, threads, optimizer, checkpointInterval, progress, progressInterval, cancel)
+    if checkpoint != None and not isinstance(checkpoint, str):
+        raise TypeError('argument \'checkpoint\' of the function fitFunctionWrapper accepts only strings')
+    if resume and not checkpoint:
+        raise ValueError('argument \'resume\' of the function fitFunctionWrapper requires the argument \'checkpoint\'')
+    if shard != None:
+        if not isinstance(shard, Tuple) or len(shard) != 2 or not all(isinstance(i, int) for i in shard):
+            raise TypeError('argument \'shard\' of the function fitFunctionWrapper accepts only tuples of two integers: the index and the count')
+        if shard[1] < 1 or shard[0] < 0 or shard[0] >= shard[1]:
+            raise ValueError('argument \'shard\' of the function fitFunctionWrapper accepts only indices from 0 to the count - 1')
+        if not checkpoint:
+            raise ValueError('argument \'shard\' of the function fitFunctionWrapper requires the argument \'checkpoint\'')
+    age, outcome = _columns('fitFunctionWrapper', df)
     functions = set(functions)
-    # when working with these arrays from the shared C library, it is critical for them be continuous in memory
-    age = np.ascontiguousarray(df['age'], dtype=np.float64)
-    outcome = np.ascontiguousarray(df['outcome'], dtype=np.intc)
     output = np.ascontiguousarray(np.zeros(18, dtype=np.float64))   # the array to collect fitted parameters and ML estimates from the shared C library
     # the first 9 values are reserved for the best fitted function
     # the second 9 values are reserved for the second best fitted function
@@ -411,9 +675,183 @@ def fitFunctionWrapper(df: pd.DataFrame, signs: str = None, oneSignSet: bool = F
     functionsToFit = np.ascontiguousarray(np.zeros(10, dtype=np.intc))
     for i in range(len(bestFit.testFuncs)):
         if i in functions: functionsToFit[i] = 1
-    clib = cdll.LoadLibrary(abspath('libdeathcurve.so'))      # loading the compiled binary shared C library, which should be located in the same directory as this Python script; absolute path is more important for Linux — not necessary for MacOS
-    f = clib.fitFunction       # assigning the C interface function to this Python variable "f"
-    f.arguments = [ c_void_p, c_void_p, c_int, c_void_p, c_void_p, c_int, c_void_p, c_int ]         # declaring the data types for C function arguments
-    f.restype = c_int      # declaring the data types for C function return value
-    res = f(c_void_p(age.ctypes.data), c_void_p(outcome.ctypes.data), age.size, c_void_p(output.ctypes.data), c_void_p(sign1.ctypes.data), sign2, c_void_p(functionsToFit.ctypes.data), polynomial_order)   # calling the C interface function
-    return bestFit(output[:9], res, int(sign1), float(df['age'].sort_values(na_position='first').reset_index(drop=True).iloc[-2]))
+    clib = _library()
+    if resume:
+        polynomial_order = clib.dcCheckpointOrder(checkpoint.encode())
+        if polynomial_order < 0:
+            raise ValueError('the file {} is not a checkpoint of this version of the shared C library'.format(checkpoint))
+    context = clib.dcCreate(c_void_p(age.ctypes.data), c_void_p(outcome.ctypes.data), age.size, polynomial_order)     # the context keeps the state of this fit apart from the fits in the other threads
+    if not context:
+        raise MemoryError('the shared C library could not allocate the context of the fit')
+    try:
+        callback = _setUp(clib, context, threads, optimizer, checkpoint, checkpointInterval, progress, progressInterval, console, cancel)     # kept referenced until the fit returns
+        if shard:
+            clib.dcSetShard(context, shard[0], shard[1])
+        if resume:
+            res = clib.dcResume(context, checkpoint.encode(), c_void_p(output.ctypes.data), c_void_p(sign1.ctypes.data))
+            if res < 0:
+                raise ValueError('the checkpoint {} could not be read or was written for another DataFrame'.format(checkpoint))
+        else:
+            res = clib.dcFit(context, c_void_p(output.ctypes.data), c_void_p(sign1.ctypes.data), sign2, c_void_p(functionsToFit.ctypes.data))   # calling the C interface function
+            if res < 0:
+                raise MemoryError('the shared C library could not allocate the memory of the fit')
+        profile = _profile(clib, context)
+    finally:
+        clib.dcDestroy(context)
+    result = bestFit(output[:9], res, int(sign1), float(df['age'].sort_values(na_position='first').reset_index(drop=True).iloc[-2]), polynomial_order)
+    result.profile = profile
+    return result
+
+
+def fitBatch(dfs: Tuple, signs: str = None, oneSignSet: bool = False, functions: Tuple = tuple(range(len(bestFit.testFuncs))), polynomial_order: int = 5, threads: int = 0, optimizer: str = 'lattice', checkpoints: Tuple = None, checkpointInterval: float = 600.0, progress: Callable = None, progressInterval: float = 1.0, console: bool = True, cancel: cancelFlag = None) -> list:
+    """
+    fitBatch(dfs: Tuple, signs: str = None, oneSignSet: bool = False, functions: Tuple = tuple(range(len(bestFit.testFuncs))), polynomial_order: int = 5, threads: int = 0, optimizer: str = 'lattice', checkpoints: Tuple = None, checkpointInterval: float = 600.0, progress: Callable = None, progressInterval: float = 1.0, console: bool = True, cancel: cancelFlag = None) -> list
+
+    Fits several cohorts (e.g., countries or periods), each a DataFrame
+    that fitFunctionWrapper() accepts, with the same arguments at once,
+    and returns the list of their bestFit objects in the same order. The
+    fits of the functions with their signs of all the cohorts share one
+    pool of threads, so that the cores kept idle at the end of the fit of
+    one cohort fit the next cohort instead. The results are the same as
+    those of fitFunctionWrapper() called for each cohort.
+
+    checkpoints, if given, is a tuple of as many paths as there are
+    cohorts; each cohort of an interrupted batch is resumed separately
+    with fitFunctionWrapper(resume=True). progress receives the same
+    dictionaries as in fitFunctionWrapper() with the key 'cohort', the
+    position of the cohort in dfs, and may be called for several cohorts
+    at once. cancel stops all the cohorts, as does the file "stop.txt"
+    when cancel is None
+    """
+    _checkArguments('fitBatch', signs, functions, polynomial_order, threads, optimizer, checkpointInterval, progress, progressInterval, cancel)
+    if not isinstance(dfs, (Tuple, list)) or not dfs:
+        raise TypeError('function fitBatch accepts only a tuple or list of pandas DataFrames as a first parameter')
+    if checkpoints != None and (not isinstance(checkpoints, (Tuple, list)) or len(checkpoints) != len(dfs) or not all(isinstance(path, str) for path in checkpoints)):
+        raise TypeError('argument \'checkpoints\' of the function fitBatch accepts only tuples of as many strings as there are DataFrames')
+    columns = [ _columns('fitBatch', df) for df in dfs ]
+    functions = set(functions)
+    outputs = np.ascontiguousarray(np.zeros(9 * len(dfs), dtype=np.float64))     # the coefficients and the ML estimate of the cohort i are outputs[9 * i:9 * i + 9]
+    sign1 = np.full(len(dfs), _strToSigns(signs) if signs else 0, dtype=np.intc)
+    res = np.zeros(len(dfs), dtype=np.intc)
+    functionsToFit = np.ascontiguousarray(np.zeros(10, dtype=np.intc))
+    for i in range(len(bestFit.testFuncs)):
+        if i in functions: functionsToFit[i] = 1
+    clib = _library()
+    contexts = (c_void_p * len(dfs))()
+    callbacks = []      # kept referenced until the fits return
+    try:
+        for i, (age, outcome) in enumerate(columns):
+            contexts[i] = clib.dcCreate(c_void_p(age.ctypes.data), c_void_p(outcome.ctypes.data), age.size, polynomial_order)
+            if not contexts[i]:
+                raise MemoryError('the shared C library could not allocate the context of the fit')
+            callbacks.append(_setUp(clib, contexts[i], threads, optimizer, checkpoints[i] if checkpoints else None, checkpointInterval, progress, progressInterval, console, cancel, i))
+        if clib.dcFitBatch(contexts, len(dfs), c_void_p(outputs.ctypes.data), c_void_p(sign1.ctypes.data), c_int(1 if signs and oneSignSet else 0), c_void_p(functionsToFit.ctypes.data), c_void_p(res.ctypes.data)) < 0:
+            raise MemoryError('the shared C library could not allocate the memory of the fits')
+        profiles = [ _profile(clib, context) for context in contexts ]
+    finally:
+        for context in contexts:
+            if context:
+                clib.dcDestroy(context)
+    results = []
+    for i, df in enumerate(dfs):
+        result = bestFit(outputs[9 * i:9 * i + 9], int(res[i]), int(sign1[i]), float(df['age'].sort_values(na_position='first').reset_index(drop=True).iloc[-2]), polynomial_order)
+        result.profile = profiles[i]
+        results.append(result)
+    return results
+
+
+def bootstrap(df: pd.DataFrame, fit: bestFit, replicates: int = 200, seed: int = 0, ages: np.ndarray = None, levels: Tuple = (0.025, 0.5, 0.975), threads: int = 0, optimizer: str = 'lattice', console: bool = True, cancel: cancelFlag = None) -> dict:
+    """
+    bootstrap(df: pd.DataFrame, fit: bestFit, replicates: int = 200, seed: int = 0, ages: np.ndarray = None, levels: Tuple = (0.025, 0.5, 0.975), threads: int = 0, optimizer: str = 'lattice', console: bool = True, cancel: cancelFlag = None) -> dict
+
+    Estimates the uncertainty of the fit that fitFunctionWrapper(),
+    fitBatch(), or mergeShards() returned for the DataFrame, at the
+    polynomial order of the fit: each replicate reweights
+    the distinct ages of the cohort with Poisson counts of their deaths
+    and survivors and refits the same function with the same signs from
+    the fitted coefficients, all the replicates in parallel in the shared
+    C library. The results are the same for a seed with any number of
+    threads. Returns a dictionary with the keys 'ages' (by default every
+    year up to the end of the plot of the fit), 'levels', 'bands' (a row
+    of the percentiles of the probabilities of death at the ages for each
+    level), 'coefficients' (a row of the eight coefficients of each
+    replicate in the order of bestFit.parameters), and 'ml' (the ML
+    estimate of each replicate on its own weights). cancel stops the
+    bootstrap, as does the file "stop.txt" when cancel is None, and a
+    stopped bootstrap returns the replicates fitted so far
+    """
+    if not isinstance(fit, bestFit):
+        raise TypeError('argument \'fit\' of the function bootstrap accepts only objects of the class bestFit')
+    polynomialOrder = getattr(fit, 'polynomialOrder', 5)     # a bestFit saved before it kept its order
+    _checkArguments('bootstrap', None, (), polynomialOrder, threads, optimizer, 600.0, None, 1.0, cancel)
+    if not isinstance(replicates, int) or replicates < 1:
+        raise ValueError('argument \'replicates\' of the function bootstrap accepts only positive integers')
+    if not isinstance(seed, int) or seed < 0:
+        raise ValueError('argument \'seed\' of the function bootstrap accepts only non-negative integers')
+    if not all(isinstance(level, (int, float)) and 0.0 <= level <= 1.0 for level in levels):
+        raise ValueError('argument \'levels\' of the function bootstrap accepts only numbers from 0 to 1')
+    age, outcome = _columns('bootstrap', df)
+    grid = np.ascontiguousarray(np.arange(0.0, fit.submaxAge, 1.0) if ages is None else np.asarray(ages, dtype=np.float64).ravel(), dtype=np.float64)
+    percentiles = np.ascontiguousarray(levels, dtype=np.float64)
+    output = np.ascontiguousarray(np.append(fit.parameters, fit.ml), dtype=np.float64)
+    bands = np.zeros((percentiles.size, grid.size), dtype=np.float64)
+    coefficients = np.zeros((replicates, 9), dtype=np.float64)
+    clib = _library()
+    context = clib.dcCreate(c_void_p(age.ctypes.data), c_void_p(outcome.ctypes.data), age.size, polynomialOrder)
+    if not context:
+        raise MemoryError('the shared C library could not allocate the context of the fit')
+    try:
+        _setUp(clib, context, threads, optimizer, None, 600.0, None, 1.0, console, cancel)
+        done = clib.dcBootstrap(context, fit.best, fit.signs, c_void_p(output.ctypes.data), replicates, seed % 2 ** 64, c_void_p(grid.ctypes.data), grid.size,
+                                c_void_p(percentiles.ctypes.data), percentiles.size, c_void_p(bands.ctypes.data), c_void_p(coefficients.ctypes.data))
+    finally:
+        clib.dcDestroy(context)
+    if done < 0:
+        raise MemoryError('the shared C library could not allocate the memory of the bootstrap')
+    return dict(ages=grid, levels=tuple(levels), bands=bands if done else np.full(bands.shape, np.nan), coefficients=coefficients[:done, :8], ml=coefficients[:done, 8])
+
+
+def mergeShards(checkpoints: Tuple) -> bestFit:
+    """
+    mergeShards(checkpoints: Tuple) -> bestFit
+
+    Picks the best fit from the checkpoints of all the shards of one fit
+    (see the argument 'shard' of fitFunctionWrapper()), given in any
+    order, exactly as fitFunctionWrapper() would have picked it without
+    the shards. It needs no DataFrame, as the checkpoints hold the second
+    largest age that ends the plot of bestFit.plotModel()
+    """
+    if not isinstance(checkpoints, (Tuple, list)) or not checkpoints or not all(isinstance(path, str) for path in checkpoints):
+        raise TypeError('function mergeShards accepts only a tuple of the paths of the checkpoints')
+    clib = _library()
+    paths = (c_char_p * len(checkpoints))(*(path.encode() for path in checkpoints))
+    output = np.ascontiguousarray(np.zeros(9, dtype=np.float64))
+    sign1 = np.zeros(1, dtype=np.intc)
+    submaxAge = c_double(0.0)
+    res = clib.dcMergeShards(paths, len(checkpoints), c_void_p(output.ctypes.data), c_void_p(sign1.ctypes.data), byref(submaxAge))
+    if res == -2:
+        raise ValueError('a shard has not finished its fits; resume it with fitFunctionWrapper(resume=True) first')
+    if res < 0:
+        raise ValueError('the files are not the checkpoints of all the shards of one fit')
+    return bestFit(output, res, int(sign1), submaxAge.value, clib.dcCheckpointOrder(paths[0]))
+
+
+def writeCohort(df: pd.DataFrame, path: str) -> None:
+    """
+    writeCohort(df: pd.DataFrame, path: str) -> None
+
+    Writes the two-column DataFrame that fitFunctionWrapper() accepts
+    (age and outcome) into the binary columnar file of the command-line
+    driver dcfit (see dcfit.c), which maps it into memory instead of
+    parsing it: the magic "DCCOHORT", the version 1, four reserved bytes,
+    and the number of rows, followed by the ages as float64 and the
+    outcomes as int32, all little-endian
+    """
+    if not isinstance(df, pd.DataFrame) or df.shape[1] != 2:
+        raise TypeError('function writeCohort accepts only pandas DataFrames with two columns: age and outcome')
+    age = np.ascontiguousarray(df.iloc[:, 0], dtype='<f8')
+    outcome = np.ascontiguousarray(df.iloc[:, 1] != 0, dtype='<i4')
+    with open(path, 'wb') as f:
+        f.write(b'DCCOHORT' + np.array([1, 0], dtype='<u4').tobytes() + np.array([age.size], dtype='<u8').tobytes())
+        f.write(age.tobytes())
+        f.write(outcome.tobytes())
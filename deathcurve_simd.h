@@ -0,0 +1,339 @@
+/*
+Vector kernels of the shared C library deathcurve.c.
+
+This file is not a standalone header: deathcurve.c includes it once for
+each instruction set with SIMD_WIDTH defined as 4 (AVX2 + FMA) or 8
+(AVX-512F), and the functions defined here get the suffixes Avx2 and
+Avx512 respectively. The transcendental functions below are only as
+general as the likelihood kernel needs them to be.
+
+Copyright (C) 2020  Alexander Yuryatin
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef DEATHCURVE_SIMD_TABLES
+#define DEATHCURVE_SIMD_TABLES
+
+#define ERF_INTERVALS 24     // erf is tabulated on [0, 6) in intervals of 0.25; above 6 it is 1.0 in double precision
+#define ERF_TERMS 12
+#define ATAN_TERMS 11
+#define ATAN_REDUCED_MAX_SQUARE 1.71572875253809987e-01    // tan(pi/8) ^ 2
+#define LN2_HI 6.93147180369123816490e-01
+#define LN2_LO 1.90821492927058770002e-10
+
+/* Coefficients of the Chebyshev interpolants of erf on each interval (12 nodes, computed with 70 significant digits)
+converted to the powers of t = 8 * x - 2 * interval - 1, which runs from -1 to 1 within the interval */
+static const double erfTable[ERF_INTERVALS * ERF_TERMS] = {
+    1.40316204801333805e-01, 1.38860658699582806e-01, -2.16969779218088854e-03, -7.00631578725102407e-04, 1.67741935419809569e-05, 3.17937181555780416e-06, -8.64516966720915612e-08, -1.14420747451281881e-08, 3.34145491291070426e-10, 3.36023976516316898e-11, -1.02526258514060371e-12, -8.24539533992458423e-14,
+    4.04116909434822313e-01, 1.22544101193238483e-01, -5.74425474343290277e-03, -4.58742566315836287e-04, 4.06697723516446149e-05, 1.38779754800393730e-06, -1.91141713967696069e-07, -2.60300364259548709e-09, 6.70472868916388876e-10, 9.24392062336587644e-13, -1.85820602228435852e-12, 1.34017668907780210e-14,
+    6.23240882188417999e-01, 9.54374419700756149e-02, -7.45605015391213616e-03, -1.08734064744558625e-04, 4.30810189554662687e-05, -8.36590913801998778e-07, -1.57718022894025922e-07, 6.63280867841754671e-09, 3.98524686683584089e-10, -2.70700214362379645e-11, -6.82260538862676934e-13, 7.83899590671895257e-14,
+    7.84075061059859690e-01, 6.55931306612685255e-02, -7.17424866607634278e-03, 1.81491409707284118e-04, 2.74405670019237669e-05, -2.05126578926537208e-06, -3.95499688176660203e-08, 8.86713341336456733e-09, -1.10029505622056712e-10, -2.42653403137843662e-11, 8.28084879067449150e-13, 4.52497458351626399e-14,
+    8.88388231701707776e-01, 3.97842448125961604e-02, -5.59465942677140737e-03, 3.17289712860877482e-04, 6.82941824641246577e-06, -1.87145030538532359e-06, 5.92683201135613577e-08, 4.58092429817161948e-09, -3.59484230571155813e-10, -2.68394122859705212e-12, 1.06789778864672179e-12, -2.03316379986102657e-14,
+    9.48170072782090312e-01, 2.12949717109394490e-02, -3.66007326281770360e-03, 3.08472083703389879e-04, -7.44643811625217035e-06, -9.34020271909888111e-07, 8.45384042773519608e-08, -6.76661530865049261e-10, -2.53978770557266085e-10, 1.17560991858458673e-11, 3.02604892028571200e-13, -3.92492339422008768e-14,
+    9.78443733239983682e-01, 1.00590323778138955e-02, -2.04324095174340283e-03, 2.24298085247477561e-04, -1.21383943264720198e-05, -6.51527356110368687e-08, 5.49880283939116313e-08, -2.94888569983337647e-09, -3.43678937604584135e-11, 1.05104480863313441e-11, -3.27704634944439491e-13, -1.46520336758870584e-14,
+    9.91990057670119940e-01, 4.19322855302700897e-03, -9.82787942115686836e-04, 1.31720883908561950e-04, -1.03173538847309891e-05, 3.49810283367374761e-07, 1.56600470514816544e-08, -2.35004141160790775e-09, 8.52627717053083722e-11, 2.69914799854305496e-12, -3.61786691792860506e-13, 8.47014737671366647e-15,
+    9.97345970640517665e-01, 1.54260257679171195e-03, -4.09753809460306026e-04, 6.45261820044704804e-05, -6.43574912310817168e-06, 3.81331866199992982e-07, -6.94813801603717727e-09, -8.91331345289570555e-10, 8.24545517149969631e-11, -2.15897605615264442e-12, -1.14988712431328521e-13, 1.09960579451114923e-14,
+    9.99217061782108895e-01, 5.00809732708777395e-04, -1.48677889397928894e-04, 2.68174482521466445e-05, -3.20635096752347062e-06, 2.55047388723850850e-07, -1.18792693386876242e-08, 5.87795491658183390e-11, 3.54128119818198997e-11, -2.51479746068646376e-12, 5.00429544921842899e-14, 3.69675196597764756e-15,
+    9.99794624263858789e-01, 1.43484390735334371e-04, -4.70808157100350303e-05, 9.55161390148980917e-06, -1.32184907384994845e-06, 1.28719500781744432e-07, -8.57099109484819831e-09, 3.24663221881112800e-10, 2.06531514953785479e-12, -1.13698726468433239e-12, 6.85842295413145849e-14, -1.17949685382476085e-15,
+    9.99952145160256212e-01, 3.62785353578122540e-05, -1.30375986442127544e-05, 2.93464063685435539e-06, -4.59414079841435260e-07, 5.22846459893417854e-08, -4.34903950054094298e-09, 2.52041840236813090e-10, -8.08296606810502469e-12, -1.20252658837600247e-13, 3.11830722615168897e-14, -1.71783175664480539e-15,
+    9.99990103265374741e-01, 8.09483540433912243e-06, -3.16204507981857784e-06, 7.81288638472158094e-07, -1.36126452427106791e-07, 1.76074676966646972e-08, -1.72544540196191427e-09, 1.27068065816510908e-10, -6.63196342185612712e-12, 1.89624682965291988e-13, 3.72640644805883773e-15, -7.43284835294036600e-16,
+    9.99998184718572602e-01, 1.59396759997063644e-06, -6.72455081237064853e-07, 1.80826077014868574e-07, -3.46406304119345555e-08, 4.99798414527266716e-09, -5.58505533125067271e-10, 4.87261741699760492e-11, -3.26914504280286752e-12, 1.58440655303483468e-13, -4.24074423630797594e-15, -7.87480650734054804e-17,
+    9.99999704859807492e-01, 2.76990035579139205e-07, -1.25511109871756426e-07, 3.64721580051207324e-08, -7.60951960126593115e-09, 1.20826218711105988e-09, -1.50791600791047214e-10, 1.50271036342957165e-11, -1.19741044655037180e-12, 7.49178859063404504e-14, -3.45977489973148725e-15, 9.29170005854141086e-17,
+    9.99999957486055968e-01, 4.24777977226144314e-08, -2.05751832719596901e-08, 6.42283106840935841e-09, -1.44836698570871402e-09, 2.50514083005599762e-10, -3.44127272773565848e-11, 3.83050313035663512e-12, -3.48622249050456251e-13, 2.58882312146021628e-14, -1.54535240372093118e-15, 6.93673632394863109e-17,
+    9.99999994576599160e-01, 5.74874478605754613e-09, -2.96419653035565314e-09, 9.89001178201668280e-10, -2.39538342137659107e-10, 4.47688401351074098e-11, -6.69657019921657042e-12, 8.19997282215285732e-13, -8.32769285843384892e-14, 7.05120068720565327e-15, -4.99647201314565558e-16, 2.85693952106035263e-17,
+    9.99999999387516714e-01, 6.86589653606672593e-10, -3.75478716832867725e-10, 1.33317294394101634e-10, -3.44983291739677945e-11, 6.92158472327397939e-12, -1.11800500940203831e-12, 1.48938246736182813e-13, -1.66177249955715041e-14, 1.56713512587357722e-15, -1.26672346169786964e-16, 8.51030621955222521e-18,
+    9.99999999938783857e-01, 7.23660170823399615e-11, -4.18366036302720624e-11, 1.57476179753629056e-11, -4.33414679073005570e-12, 9.28454495433090521e-13, -1.60862199750839044e-13, 2.31168916747378384e-14, -2.80207558194541695e-15, 2.89787264160554840e-16, -2.61112097082132733e-17, 1.98432338801536471e-18,
+    9.99999999994586553e-01, 6.73108811512346780e-12, -4.10175682112111773e-12, 1.63128095764942404e-12, -4.75667588711850448e-13, 1.08297347292165549e-13, -2.00159985910552613e-14, 3.08203109053218560e-15, -4.02417324606259976e-16, 4.51368663423685327e-17, -4.46591005479324925e-18, 3.75505849331851289e-19,
+    9.99999999999576561e-01, 5.52521358667156377e-13, -3.53958995563358287e-13, 1.48292272219314628e-13, -4.56563300581446489e-14, 1.10043149121533030e-14, -2.15965336976800082e-15, 3.54354095501960262e-16, -4.95049677998273587e-17, 5.97212648560205141e-18, -6.41955749741082953e-19, 5.88588040461771153e-20,
+    9.99999999999970690e-01, 4.00245129780693555e-14, -2.68914696810530125e-14, 1.18366764473741064e-14, -3.83632347694585652e-15, 9.75527566714834062e-16, -2.02494038551297919e-16, 3.52422933344093956e-17, -5.23931124843893885e-18, 6.75348389334814208e-19, -7.82407510101558286e-20, 7.74154049269945897e-21,
+    9.99999999999998224e-01, 2.55868151052637308e-15, -1.79907293995577895e-15, 8.29988973303329197e-16, -2.82422793389979958e-16, 7.55408438966493155e-17, -1.65282665618474410e-17, 3.03936420955918465e-18, -4.78647313398715288e-19, 6.55741103347952643e-20, -8.13698621743616103e-21, 8.62066281076308690e-22,
+    9.99999999999999889e-01, 1.44350933043414870e-16, -1.06007716744485798e-16, 5.11477834307513148e-17, -1.82286998087170130e-17, 5.11492602108869258e-18, -1.17615284558581935e-18, 2.27751610350188812e-19, -3.78477886248517764e-20, 5.48660559852811870e-21, -7.25587320852453341e-22, 8.18034648346033975e-23
+};
+/* The same for atan(z) / z as a function of z ^ 2 on [0, tan(pi/8) ^ 2], in powers of tau = 2 * z ^ 2 / tan(pi/8) ^ 2 - 1 */
+static const double atanTable[ATAN_TERMS] = {
+    9.72791817360354361e-01, -2.59001954598134555e-02, 1.23359187900961924e-03, -6.98007065510748654e-05, 4.29654973502508992e-06, -2.78068233218613060e-07, 1.86057904496727126e-08, -1.27476355704001564e-09, 8.89142043467902923e-11, -6.37870649814598733e-12, 4.56243044437866134e-13
+};
+
+#endif
+
+
+#if SIMD_WIDTH == 4
+
+#define SIMD_TARGET __attribute__((target("avx2,fma")))
+#define SIMD(name) name##Avx2
+#define VD __m256d
+#define VI __m256i
+#define VM __m256d
+#define vSet(x) _mm256_set1_pd(x)
+#define vSetI(x) _mm256_set1_epi64x(x)
+#define vLoad(p) _mm256_loadu_pd(p)
+#define vAdd(a, b) _mm256_add_pd(a, b)
+#define vSub(a, b) _mm256_sub_pd(a, b)
+#define vMul(a, b) _mm256_mul_pd(a, b)
+#define vDiv(a, b) _mm256_div_pd(a, b)
+#define vFma(a, b, c) _mm256_fmadd_pd(a, b, c)
+#define vSqrt(a) _mm256_sqrt_pd(a)
+#define vMin(a, b) _mm256_min_pd(a, b)    // returns b if a is NaN
+#define vFloor(a) _mm256_floor_pd(a)
+#define vAbs(a) _mm256_andnot_pd(_mm256_set1_pd(-0.0), a)
+#define vSignBit(a) _mm256_and_pd(_mm256_set1_pd(-0.0), a)
+#define vXor(a, b) _mm256_xor_pd(a, b)
+#define vLe(a, b) _mm256_cmp_pd(a, b, _CMP_LE_OQ)
+#define vLt(a, b) _mm256_cmp_pd(a, b, _CMP_LT_OQ)
+#define vGt(a, b) _mm256_cmp_pd(a, b, _CMP_GT_OQ)
+#define vGe(a, b) _mm256_cmp_pd(a, b, _CMP_GE_OQ)
+#define vNotLe(a, b) _mm256_cmp_pd(a, b, _CMP_NLE_UQ)
+#define vOr(a, b) _mm256_or_pd(a, b)
+#define vSelect(m, a, b) _mm256_blendv_pd(b, a, m)
+#define vAsInt(a) _mm256_castpd_si256(a)
+#define vAsDouble(a) _mm256_castsi256_pd(a)
+#define vAndI(a, b) _mm256_and_si256(a, b)
+#define vOrI(a, b) _mm256_or_si256(a, b)
+#define vSubI(a, b) _mm256_sub_epi64(a, b)
+#define vShiftRightI(a, n) _mm256_srli_epi64(a, n)
+#define vGather(table, index) _mm256_i64gather_pd(table, index, 8)
+
+static inline SIMD_TARGET double vSumAvx2(__m256d a) {
+    __m128d half = _mm_add_pd(_mm256_castpd256_pd128(a), _mm256_extractf128_pd(a, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(half, _mm_unpackhi_pd(half, half)));
+}
+#define vSum(a) vSumAvx2(a)
+
+#elif SIMD_WIDTH == 8
+
+#define SIMD_TARGET __attribute__((target("avx512f")))
+#define SIMD(name) name##Avx512
+#define VD __m512d
+#define VI __m512i
+#define VM __mmask8
+#define vSet(x) _mm512_set1_pd(x)
+#define vSetI(x) _mm512_set1_epi64(x)
+#define vLoad(p) _mm512_loadu_pd(p)
+#define vAdd(a, b) _mm512_add_pd(a, b)
+#define vSub(a, b) _mm512_sub_pd(a, b)
+#define vMul(a, b) _mm512_mul_pd(a, b)
+#define vDiv(a, b) _mm512_div_pd(a, b)
+#define vFma(a, b, c) _mm512_fmadd_pd(a, b, c)
+#define vSqrt(a) _mm512_sqrt_pd(a)
+#define vMin(a, b) _mm512_min_pd(a, b)    // returns b if a is NaN
+#define vFloor(a) _mm512_roundscale_pd(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC)
+#define vAbs(a) _mm512_castsi512_pd(_mm512_andnot_si512(_mm512_set1_epi64(INT64_MIN), _mm512_castpd_si512(a)))
+#define vSignBit(a) _mm512_castsi512_pd(_mm512_and_si512(_mm512_set1_epi64(INT64_MIN), _mm512_castpd_si512(a)))
+#define vXor(a, b) _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a), _mm512_castpd_si512(b)))
+#define vLe(a, b) _mm512_cmp_pd_mask(a, b, _CMP_LE_OQ)
+#define vLt(a, b) _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ)
+#define vGt(a, b) _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ)
+#define vGe(a, b) _mm512_cmp_pd_mask(a, b, _CMP_GE_OQ)
+#define vNotLe(a, b) _mm512_cmp_pd_mask(a, b, _CMP_NLE_UQ)
+#define vOr(a, b) ((__mmask8) ((a) | (b)))
+#define vSelect(m, a, b) _mm512_mask_blend_pd(m, b, a)
+#define vAsInt(a) _mm512_castpd_si512(a)
+#define vAsDouble(a) _mm512_castsi512_pd(a)
+#define vAndI(a, b) _mm512_and_si512(a, b)
+#define vOrI(a, b) _mm512_or_si512(a, b)
+#define vSubI(a, b) _mm512_sub_epi64(a, b)
+#define vShiftRightI(a, n) _mm512_srli_epi64(a, n)
+#define vGather(table, index) _mm512_i64gather_pd(index, table, 8)
+#define vSum(a) _mm512_reduce_add_pd(a)
+
+#endif
+
+
+/* converts the lanes holding small non-negative integral values into 64-bit integers */
+static inline SIMD_TARGET VI SIMD(vecToIndex)(VD x) {
+    return vSubI(vAsInt(vAdd(x, vSet(0x1p52))), vAsInt(vSet(0x1p52)));
+}
+
+/* natural logarithm of positive numbers (subnormal ones included); infinities and NaNs are returned as they are */
+static inline SIMD_TARGET VD SIMD(vecLog)(VD x) {
+    VM tiny = vLt(x, vSet(DBL_MIN));
+    VD scaled = vSelect(tiny, vMul(x, vSet(0x1p54)), x);
+    VI bits = vAsInt(scaled);
+    VD exponent = vSub(vAsDouble(vOrI(vShiftRightI(bits, 52), vSetI(0x4330000000000000))), vSet(0x1p52));
+    exponent = vSub(exponent, vSelect(tiny, vSet(1077.0), vSet(1023.0)));
+    VD m = vAsDouble(vOrI(vAndI(bits, vSetI(0x000fffffffffffff)), vSetI(0x3ff0000000000000)));
+    VM big = vGt(m, vSet(M_SQRT2));
+    m = vSelect(big, vMul(m, vSet(0.5)), m);
+    exponent = vSelect(big, vAdd(exponent, vSet(1.0)), exponent);
+    /* log(m) = 2 * atanh(s) with |s| < 0.172, summed up to s ^ 21 */
+    VD f = vSub(m, vSet(1.0));
+    VD s = vDiv(f, vAdd(f, vSet(2.0)));
+    VD z = vMul(s, s);
+    VD r = vSet(2.0 / 21.0);
+    r = vFma(r, z, vSet(2.0 / 19.0));
+    r = vFma(r, z, vSet(2.0 / 17.0));
+    r = vFma(r, z, vSet(2.0 / 15.0));
+    r = vFma(r, z, vSet(2.0 / 13.0));
+    r = vFma(r, z, vSet(2.0 / 11.0));
+    r = vFma(r, z, vSet(2.0 / 9.0));
+    r = vFma(r, z, vSet(2.0 / 7.0));
+    r = vFma(r, z, vSet(2.0 / 5.0));
+    r = vFma(r, z, vSet(2.0 / 3.0));
+    r = vMul(r, z);
+    VD logM = vSub(f, vMul(s, vSub(f, r)));
+    VD result = vFma(exponent, vSet(LN2_HI), vFma(exponent, vSet(LN2_LO), logM));
+    return vSelect(vNotLe(x, vSet(DBL_MAX)), x, result);
+}
+
+static inline SIMD_TARGET VD SIMD(vecErf)(VD x) {
+    VD a = vAbs(x);
+    VD interval = vFloor(vMin(vMul(a, vSet(4.0)), vSet(ERF_INTERVALS - 1)));
+    VD t = vSub(vMul(a, vSet(8.0)), vFma(interval, vSet(2.0), vSet(1.0)));
+    VI index = SIMD(vecToIndex)(vMul(interval, vSet(ERF_TERMS)));
+    VD r = vGather(erfTable + ERF_TERMS - 1, index);
+    for (int j = ERF_TERMS - 2; j >= 0; --j)
+        r = vFma(r, t, vGather(erfTable + j, index));
+    r = vSelect(vGe(a, vSet(ERF_INTERVALS * 0.25)), vSet(1.0), r);
+    return vXor(r, vSignBit(x));
+}
+
+/* arctangent on [-1, 1] */
+static inline SIMD_TARGET VD SIMD(vecAtan)(VD x) {
+    VD a = vAbs(x);
+    VM big = vGt(a, vSet(M_SQRT2 - 1.0));
+    VD z = vSelect(big, vDiv(vSub(a, vSet(1.0)), vAdd(a, vSet(1.0))), a);
+    VD tau = vFma(vMul(z, z), vSet(2.0 / ATAN_REDUCED_MAX_SQUARE), vSet(-1.0));
+    VD r = vSet(atanTable[ATAN_TERMS - 1]);
+    for (int j = ATAN_TERMS - 2; j >= 0; --j)
+        r = vFma(r, tau, vSet(atanTable[j]));
+    r = vFma(z, r, vSelect(big, vSet(M_PI_4), vSet(0.0)));
+    return vXor(r, vSignBit(x));
+}
+
+/* tanh(log(x)) = (x ^ 2 - 1) / (x ^ 2 + 1), rearranged for large x to avoid the overflow */
+static inline SIMD_TARGET VD SIMD(vecTanhLog)(VD x) {
+    VD square = vMul(x, x);
+    VD inverse = vDiv(vSet(1.0), square);
+    VM up = vGe(x, vSet(1.0));
+    VD numerator = vSelect(up, vSub(vSet(1.0), inverse), vSub(square, vSet(1.0)));
+    VD denominator = vSelect(up, vAdd(vSet(1.0), inverse), vAdd(square, vSet(1.0)));
+    return vDiv(numerator, denominator);
+}
+
+static inline SIMD_TARGET VD SIMD(vecLogVerified)(VD x) {
+    VM invalid = vOr(vLe(x, vSet(0.0)), vGt(x, vSet(1.0)));
+    return vSelect(invalid, vSet(-DBL_MAX), SIMD(vecLog)(vSelect(invalid, vSet(1.0), x)));
+}
+
+/* the sigmoid part of each of the five pairs of functions evaluated from the positive value of the internal polynomial */
+static inline __attribute__((always_inline)) SIMD_TARGET VD SIMD(vecLink)(const int link, VD poly) {
+    VD temp;
+    switch (link) {
+        case 0:
+            return SIMD(vecErf)(SIMD(vecLog)(poly));
+        case 1:
+            return SIMD(vecTanhLog)(poly);
+        case 2:
+            return vMul(SIMD(vecAtan)(SIMD(vecTanhLog)(poly)), vSet(M_1_PI * 4.0));
+        case 3:
+            temp = SIMD(vecLog)(poly);
+            return vDiv(temp, vSqrt(vFma(temp, temp, vSet(1.0))));
+        default:
+            temp = SIMD(vecLog)(poly);
+            return vDiv(temp, vAdd(vSet(1.0), vAbs(temp)));
+    }
+}
+
+/* the log-likelihood of all bins for one set of coefficients; see batchSumScalar in deathcurve.c for the scalar version */
+static inline __attribute__((always_inline)) SIMD_TARGET double SIMD(batchSum)(const double * age, const double * deathColumn, const double * survivorColumn, const int binsPadded,
+                                                                              const int link, const int floorAndCeiling, const int degree, const double * c, double bound, int * abandoned) {
+    const double * coefficients = floorAndCeiling ? c + 2 : c;
+    VD scale = vSet(floorAndCeiling ? 0.5 - c[1] : 0.5);
+    VD ceiling = vSet(c[1]), floor = vSet(c[0]);
+    VD polynomial[8];
+    for (int k = 0; k <= degree; ++k)
+        polynomial[k] = vSet(coefficients[k]);
+    VD sum = vSet(0.0);
+    for (int i = 0; i < binsPadded; i += SIMD_WIDTH) {
+        VD x = vLoad(age + i);
+        VD deaths = vLoad(deathColumn + i);
+        VD survivors = vLoad(survivorColumn + i);
+        VD poly = polynomial[degree];
+        for (int k = degree - 1; k >= 0; --k)
+            poly = vFma(poly, x, polynomial[k]);
+        VM invalid = vLe(poly, vSet(0.0));
+        VD result = vFma(SIMD(vecLink)(link, vSelect(invalid, vSet(1.0), poly)), scale, vSet(0.5));
+        if (floorAndCeiling) result = vAdd(vSub(result, ceiling), floor);
+        /* the bins without deaths or survivors must not turn a NaN into the sum */
+        VD term = vAdd(vSelect(vGt(deaths, vSet(0.0)), vMul(deaths, SIMD(vecLogVerified)(result)), vSet(0.0)),
+                       vSelect(vGt(survivors, vSet(0.0)), vMul(survivors, SIMD(vecLogVerified)(vSub(vSet(1.0), result))), vSet(0.0)));
+        term = vSelect(invalid, vAdd(vMul(deaths, vSet(-DBL_MAX)), vMul(survivors, vSet(-DBL_MAX))), term);
+        sum = vAdd(sum, term);
+        if ((i + SIMD_WIDTH) % PRUNING_BLOCK == 0 && i + SIMD_WIDTH < binsPadded && vSum(sum) < bound) {
+            * abandoned = 1;
+            break;
+        }
+    }
+    return vSum(sum);
+}
+
+/* the pruned pass and the pass in the order of the ages, as in batchBodyScalar */
+static inline __attribute__((always_inline)) SIMD_TARGET double SIMD(batchBody)(const struct binnedData * data, const int link, const int floorAndCeiling, const int degree, const double * c, double bound, int * abandoned) {
+    if (bound > -INFINITY) {
+        double partial = SIMD(batchSum)(data->prunedAge, data->prunedDeaths, data->prunedSurvivors, data->binsPadded, link, floorAndCeiling, degree, c, pruningBound(bound), abandoned);
+        if (* abandoned) return partial;
+    }
+    return SIMD(batchSum)(data->age, data->deaths, data->survivors, data->binsPadded, link, floorAndCeiling, degree, c, -INFINITY, abandoned);
+}
+
+/* one kernel for each function and polynomial order, see KERNEL_TABLE in deathcurve.c */
+#define SIMD_KERNEL(func, order) \
+    static SIMD_TARGET double SIMD(batchLogL##func##_##order)(const struct binnedData * data, const double * c, double bound, int * abandoned) { \
+        return SIMD(batchBody)(data, func / 2, func % 2, KERNEL_DEGREE(func, order), c, bound, abandoned); \
+    }
+KERNELS_OF_ALL_FUNCTIONS(SIMD_KERNEL)
+#undef SIMD_KERNEL
+
+#define SIMD_KERNEL(func, order) SIMD(batchLogL##func##_##order)
+static double (* const SIMD(batchKernels)[TOTAL_NUMBER_OF_FUNCTIONS][POLYNOMIAL_ORDERS])(const struct binnedData * data, const double * c, double bound, int * abandoned) = KERNEL_TABLE(SIMD_KERNEL);
+#undef SIMD_KERNEL
+
+
+#undef SIMD_TARGET
+#undef SIMD
+#undef VD
+#undef VI
+#undef VM
+#undef vSet
+#undef vSetI
+#undef vLoad
+#undef vAdd
+#undef vSub
+#undef vMul
+#undef vDiv
+#undef vFma
+#undef vSqrt
+#undef vMin
+#undef vFloor
+#undef vAbs
+#undef vSignBit
+#undef vXor
+#undef vLe
+#undef vLt
+#undef vGt
+#undef vGe
+#undef vNotLe
+#undef vOr
+#undef vSelect
+#undef vAsInt
+#undef vAsDouble
+#undef vAndI
+#undef vOrI
+#undef vSubI
+#undef vShiftRightI
+#undef vGather
+#undef vSum
+#undef SIMD_WIDTH
@@ -0,0 +1,717 @@
+/*
+Tests of the shared C library deathcurve.c, built and run with 'make test'.
+
+It includes deathcurve.c itself, as bench.c does, to reach the binning, the
+kernels, and the steps of the hill climbing. Each test prints one line,
+"ok" or "FAIL" with what differed, and the program exits with 1 if any of
+them failed.
+
+Copyright (C) 2020  Alexander Yuryatin
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "deathcurve.c"
+
+static int failures;
+
+/* prints the result of one test; the details are only printed if it failed */
+static void report(const char * name, int failed, const char * details) {
+    printf("%s %s%s%s\n", failed ? "FAIL" : "ok  ", name, failed ? ": " : "", failed ? details : "");
+    failures += failed != 0;
+}
+
+static uint64_t nextRandom(uint64_t * state) {
+    * state = * state * 6364136223846793005ULL + 1442695040888963407ULL;
+    return * state >> 11;
+}
+
+static double uniformRandom(uint64_t * state) {
+    return nextRandom(state) / 9007199254740992.0;
+}
+
+/* the ages are uniform from 0 to 100 years, rounded to ageResolution unless it is 0, and the deaths follow a logistic curve of the age */
+static void cohortRows(double * ages, int * outcomes, int rows, double ageResolution, uint64_t seed) {
+    for (int i = 0; i < rows; ++i) {
+        double age = uniformRandom(&seed) * 100.0;
+        if (ageResolution > 0.0) age = floor(age / ageResolution) * ageResolution;
+        ages[i] = age;
+        outcomes[i] = uniformRandom(&seed) < 0.3 / (1.0 + exp(-(age - 75.0) / 8.0));
+    }
+}
+
+/* a fit of the function at a random point of the lattice around the seeds, at the precision 0.1 */
+static void randomStep(struct fitTask * task, const dcContext * ctx, int func, uint64_t * state) {
+    double * result = task->result;
+    memset(task, 0, sizeof(* task));
+    task->ctx = ctx;
+    task->func = func;
+    task->signs = (unsigned char) nextRandom(state);
+    task->result = result;
+    convertSigns(task);
+    seedOrigin(ctx->polynOrder, task->origin);
+    task->precision = 1;
+    for (int i = 0; i < 8; ++i)
+        task->lattice[i] = (int32_t) (nextRandom(state) % 21) - 10;
+    setCandidates(task);
+}
+
+/* one of the grid points of a step that are varied for the polynomial order of the context */
+static int gridPoint(const dcContext * ctx, uint64_t * state) {
+    return ctx->start + (int) (nextRandom(state) % (uint64_t) ((GRID_SIZE - ctx->start + ctx->skip - 1) / ctx->skip)) * ctx->skip;
+}
+
+/* The log-likelihood of a grid point as getML summed it before the rows were binned: the function of every row,
+in the order of the rows, with all eight coefficients and the powers of the age */
+static double perRowML(int func, const double * ages, const int * outcomes, int rows, const double * c) {
+    double sum = 0.0;
+    for (int i = 0; i < rows; ++i)
+        sum += testFunc[func](ages[i], outcomes[i], c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7]);
+    return sum;
+}
+
+/* The log-likelihood of grid points of a step with the binned data and with the rows, as getML computed it before the
+binning. The binned kernel evaluates the polynomial with Horner's scheme, multiplies the term of a bin by its count and
+sums the bins in the order of the ages, so the sums are compared to a tolerance of their magnitude, and invalid
+probabilities to -DBL_MAX or -inf on both sides. The point that wins each set of grid points must be the same to the
+last bit, as the steps of the fits choose it. The grid points are taken at random and evaluated with getML and the
+scalar kernel, which the vector kernels are tested against below, with no bound, so that none of them is abandoned */
+static void testBinning(double ageResolution, double tolerance) {
+    enum { ROWS = 3000, POINTS = 32 };
+    static double ages[ROWS];
+    static int outcomes[ROWS];
+    cohortRows(ages, outcomes, ROWS, ageResolution, 17);
+    uint64_t state = 29;
+    char details[256] = "";
+    long long compared = 0, finite = 0;
+    double largest = 0.0;
+    struct fitTask task;
+    task.result = malloc(GRID_SIZE * sizeof(double));
+    for (int order = 2; order <= 7 && !details[0]; ++order) {
+        dcContext * ctx = dcCreate(ages, outcomes, ROWS, order);
+        for (int func = 0; func < TOTAL_NUMBER_OF_FUNCTIONS && !details[0]; ++func)
+            for (int repeat = 0; repeat < 2 && !details[0]; ++repeat) {
+                randomStep(&task, ctx, func, &state);
+                task.kernel = batchKernelsScalar[func][order - 2];
+                int binnedBest = -1, rowBest = -1;
+                double binnedMax = -INFINITY, rowMax = -INFINITY;
+                for (int point = 0; point < POINTS && !details[0]; ++point) {
+                    int index = gridPoint(ctx, &state);
+                    double c[8] = { task.candidates[0][index / 2187], task.candidates[1][index % 2187 / 729],
+                                    task.candidates[2][index % 729 / 243], task.candidates[3][index % 243 / 81],
+                                    task.candidates[4][index % 81 / 27], task.candidates[5][index % 27 / 9],
+                                    task.candidates[6][index % 9 / 3], task.candidates[7][index % 3] };
+                    atomic_init(&task.best, -INFINITY);
+                    int abandoned = getML(&task, index);
+                    double x = task.result[index], y = perRowML(func, ages, outcomes, ROWS, c);
+                    int valid = x > -DBL_MAX && y > -DBL_MAX;
+                    double difference = valid ? fabs(x - y) / fabs(y) : 0.0;
+                    ++compared;
+                    finite += valid;
+                    if (difference > largest) largest = difference;
+                    if (x > binnedMax) {
+                        binnedMax = x;
+                        binnedBest = index;
+                    }
+                    if (y > rowMax) {
+                        rowMax = y;
+                        rowBest = index;
+                    }
+                    if (abandoned || (valid ? !(difference <= tolerance) : x > -DBL_MAX || y > -DBL_MAX))
+                        snprintf(details, sizeof(details), "function %d, order %d, point %d: %.17g with the bins, %.17g with the rows", func, order, index, x, y);
+                }
+                if (!details[0] && binnedBest != rowBest)
+                    snprintf(details, sizeof(details), "function %d, order %d: the point %d wins with the bins, %d with the rows", func, order, binnedBest, rowBest);
+            }
+        dcDestroy(ctx);
+    }
+    free(task.result);
+    if (!details[0] && finite < compared / 10)
+        snprintf(details, sizeof(details), "only %lld of %lld grid points have valid probabilities", finite, compared);
+    char name[160];
+    snprintf(name, sizeof(name), "binning: %lld grid points within %g (at most %.1e) of the rows and the same best points (ages rounded to %g)",
+             compared, tolerance, largest, ageResolution);
+    report(name, details[0], details);
+}
+
+/* The bins of the same rows in another order are the same, so are their log-likelihoods to the last bit */
+static void testBinningOrder(void) {
+    enum { ROWS = 3000 };
+    static double ages[ROWS], shuffledAges[ROWS];
+    static int outcomes[ROWS], shuffledOutcomes[ROWS];
+    cohortRows(ages, outcomes, ROWS, 0.5, 31);
+    uint64_t state = 37;
+    for (int i = 0; i < ROWS; ++i) {
+        shuffledAges[i] = ages[i];
+        shuffledOutcomes[i] = outcomes[i];
+    }
+    for (int i = ROWS - 1; i > 0; --i) {
+        int j = (int) (nextRandom(&state) % (uint64_t) (i + 1));
+        double age = shuffledAges[i];
+        int outcome = shuffledOutcomes[i];
+        shuffledAges[i] = shuffledAges[j];
+        shuffledOutcomes[i] = shuffledOutcomes[j];
+        shuffledAges[j] = age;
+        shuffledOutcomes[j] = outcome;
+    }
+    char details[256] = "";
+    struct fitTask first, second;
+    first.result = malloc(GRID_SIZE * sizeof(double));
+    second.result = malloc(GRID_SIZE * sizeof(double));
+    dcContext * ctx = dcCreate(ages, outcomes, ROWS, 5);
+    dcContext * shuffledCtx = dcCreate(shuffledAges, shuffledOutcomes, ROWS, 5);
+    for (int func = 0; func < TOTAL_NUMBER_OF_FUNCTIONS && !details[0]; ++func) {
+        uint64_t pointState = state;
+        randomStep(&first, ctx, func, &state);
+        randomStep(&second, shuffledCtx, func, &pointState);
+        first.kernel = second.kernel = kernelFor(func, 5);
+        for (int point = 0; point < 32; ++point) {
+            int index = gridPoint(ctx, &state);
+            atomic_init(&first.best, -INFINITY);
+            atomic_init(&second.best, -INFINITY);
+            getML(&first, index);
+            getML(&second, index);
+            if (memcmp(&first.result[index], &second.result[index], sizeof(double)))
+                snprintf(details, sizeof(details), "function %d, point %d: %.17g and %.17g", func, index, first.result[index], second.result[index]);
+        }
+    }
+    dcDestroy(ctx);
+    dcDestroy(shuffledCtx);
+    free(first.result);
+    free(second.result);
+    report("binning: the shuffled rows give the same log-likelihoods to the last bit", details[0], details);
+}
+
+#if SIMD_KERNELS
+/* The vector approximations of deathcurve_simd.h against libm and the scalar sigmoids. Each of them is applied to
+arrays of inputs by one function per instruction set, which takes the number of the approximation */
+enum {APPROXIMATION_LOG, APPROXIMATION_ERF, APPROXIMATION_ATAN, APPROXIMATION_TANH_LOG, APPROXIMATION_LOG_VERIFIED,
+      APPROXIMATION_LINK, APPROXIMATIONS = APPROXIMATION_LINK + 5};
+
+static const char * const approximationNames[APPROXIMATIONS] = {
+    "log", "erf", "atan", "tanh(log)", "log verified", "link 0 (erf)", "link 1 (tanh)", "link 2 (Gudermannian)", "link 3 (x / sqrt(1 + x^2))", "link 4 (x / (1 + |x|))" };
+
+/* the value of the scalar code that the approximation replaces */
+static double approximationReference(int approximation, double x) {
+    switch (approximation) {
+        case APPROXIMATION_LOG: return log(x);
+        case APPROXIMATION_ERF: return erf(x);
+        case APPROXIMATION_ATAN: return atan(x);
+        case APPROXIMATION_TANH_LOG: return tanh(log(x));
+        case APPROXIMATION_LOG_VERIFIED: return logVerified(x);
+        default: return scalarLink(approximation - APPROXIMATION_LINK, x);
+    }
+}
+
+/* The bounds of the errors, in units in the last place of the reference for log and atan, and absolute for the others,
+whose values are probabilities or the terms of the log-likelihood. The scalar tanh(log(x)) and the sigmoids round the
+logarithm before they apply the sigmoid, so the vector ones may differ from them by a few units of 2^-53 */
+static const double approximationBounds[APPROXIMATIONS] = {1.0, 0x1p-53, 2.0, 0x1p-51, 1.0, 0x1p-51, 0x1p-51, 0x1p-51, 0x1p-51, 0x1p-51};
+
+static double unitsInLastPlace(double x, double reference) {
+    double unit = nextafter(fabs(reference), INFINITY) - fabs(reference);
+    return fabs(x - reference) / unit;
+}
+
+/* Inputs of each approximation over its whole domain, with the ends of the intervals of its tables, the numbers where it
+switches between its formulas, and the extreme, subnormal, infinite, and invalid ones; n is a multiple of SIMD_PADDING */
+static int approximationInputs(int approximation, double * x, int n, uint64_t * state) {
+    static const double logSpecial[] = {DBL_TRUE_MIN, 0x1p-1040, DBL_MIN, 0x1.fffffffffffffp-1023, 0.5, M_SQRT1_2, 1.0, 0x1.0000000000001p0,
+                                        0x1.fffffffffffffp-1, M_SQRT2, 0x1.6a09e667f3bcdp0, 0x1.6a09e667f3bccp0, 2.0, 1e300, DBL_MAX};
+    static const double erfSpecial[] = {0.0, -0.0, 1e-300, -1e-300, 0.25, 0.5, 5.75, 5.999999999999999, 6.0, -6.0, 7.0, 1e300, -1e300, INFINITY, -INFINITY};
+    static const double atanSpecial[] = {0.0, -0.0, 1e-300, M_SQRT2 - 1.0, 0x1.a827999fcef32p-2, 0x1.a827999fcef33p-2, 1.0, -1.0, 0.999999999999999, -M_SQRT2 + 1.0};
+    static const double validSpecial[] = {0.0, -0.0, -1.0, DBL_TRUE_MIN, DBL_MIN, 1e-300, 0.5, 0x1.fffffffffffffp-1, 1.0, 0x1.0000000000001p0, 2.0, INFINITY};
+    const double * special;
+    int specials;
+    if (approximation == APPROXIMATION_ERF) {
+        special = erfSpecial;
+        specials = sizeof(erfSpecial) / sizeof(double);
+    } else if (approximation == APPROXIMATION_ATAN) {
+        special = atanSpecial;
+        specials = sizeof(atanSpecial) / sizeof(double);
+    } else if (approximation == APPROXIMATION_LOG_VERIFIED) {
+        special = validSpecial;
+        specials = sizeof(validSpecial) / sizeof(double);
+    } else {
+        special = logSpecial;
+        specials = sizeof(logSpecial) / sizeof(double);
+    }
+    for (int i = 0; i < n; ++i) {
+        double u = uniformRandom(state);
+        if (i < specials)
+            x[i] = special[i];
+        else if (approximation == APPROXIMATION_ERF)
+            x[i] = i % 2 ? (u - 0.5) * 14.0 : ldexp(u - 0.5, -(int) (nextRandom(state) % 60));
+        else if (approximation == APPROXIMATION_ATAN)
+            x[i] = (u - 0.5) * 2.0;
+        else if (approximation == APPROXIMATION_LOG_VERIFIED)
+            x[i] = i % 2 ? u : ldexp(0.5 + u * 0.5, -(int) (nextRandom(state) % 1074));
+        else if (i % 2)
+            x[i] = exp((u - 0.5) * 40.0);      // the values of the polynomials where the sigmoids are not yet 0 or 1
+        else
+            x[i] = ldexp(1.0 + u, (int) (nextRandom(state) % 2046) - 1022 - (int) (nextRandom(state) % 53 == 0) * 52);
+    }
+    return specials;
+}
+
+/* the largest error of the approximation in the unit of its bound; both values must be NaN, or equal where they are
+infinite or -DBL_MAX */
+static double approximationError(int approximation, double x, double reference) {
+    if (isnan(reference) || isnan(x)) return isnan(reference) && isnan(x) ? 0.0 : INFINITY;
+    if (isinf(reference) || reference == -DBL_MAX || isinf(x) || x == -DBL_MAX) return x == reference ? 0.0 : INFINITY;
+    if (approximation == APPROXIMATION_LOG || approximation == APPROXIMATION_ATAN || approximation == APPROXIMATION_LOG_VERIFIED)
+        return unitsInLastPlace(x, reference) / approximationBounds[approximation];
+    return fabs(x - reference) / approximationBounds[approximation];
+}
+
+#define APPLY_APPROXIMATION(isa, target, vector, width, load, store) \
+    static target void applyApproximation##isa(int approximation, const double * x, double * y, int n) { \
+        for (int i = 0; i < n; i += width) { \
+            vector v = load(x + i); \
+            switch (approximation) { \
+                case APPROXIMATION_LOG: v = vecLog##isa(v); break; \
+                case APPROXIMATION_ERF: v = vecErf##isa(v); break; \
+                case APPROXIMATION_ATAN: v = vecAtan##isa(v); break; \
+                case APPROXIMATION_TANH_LOG: v = vecTanhLog##isa(v); break; \
+                case APPROXIMATION_LOG_VERIFIED: v = vecLogVerified##isa(v); break; \
+                default: v = vecLink##isa(approximation - APPROXIMATION_LINK, v); \
+            } \
+            store(y + i, v); \
+        } \
+    }
+APPLY_APPROXIMATION(Avx2, __attribute__((target("avx2,fma"))), __m256d, 4, _mm256_loadu_pd, _mm256_storeu_pd)
+APPLY_APPROXIMATION(Avx512, __attribute__((target("avx512f"))), __m512d, 8, _mm512_loadu_pd, _mm512_storeu_pd)
+#undef APPLY_APPROXIMATION
+
+static void testApproximations(int level) {
+    enum { INPUTS = 1 << 16 };
+    static double x[INPUTS], y[INPUTS];
+    const char * isa = level == 2 ? "AVX-512" : "AVX2";
+    uint64_t state = 41;
+    for (int approximation = 0; approximation < APPROXIMATIONS; ++approximation) {
+        approximationInputs(approximation, x, INPUTS, &state);
+        if (level == 2) applyApproximationAvx512(approximation, x, y, INPUTS);
+        else applyApproximationAvx2(approximation, x, y, INPUTS);
+        double worst = 0.0;
+        int worstInput = 0;
+        for (int i = 0; i < INPUTS; ++i) {
+            double error = approximationError(approximation, y[i], approximationReference(approximation, x[i]));
+            if (!(error <= worst)) {
+                worst = error;
+                worstInput = i;
+            }
+        }
+        char name[128], details[256];
+        snprintf(name, sizeof(name), "simd: %s %s within %g %s of the scalar code", isa, approximationNames[approximation], approximationBounds[approximation],
+                 approximation == APPROXIMATION_LOG || approximation == APPROXIMATION_ATAN || approximation == APPROXIMATION_LOG_VERIFIED ? "ulp" : "absolute");
+        snprintf(details, sizeof(details), "%.17g gives %.17g instead of %.17g", x[worstInput], y[worstInput], approximationReference(approximation, x[worstInput]));
+        report(name, worst > 1.0, details);
+    }
+}
+
+/* The bound of the difference between a vector and the scalar kernel: 1e-12 of the sum for the order of the summation, and
+the error of the probabilities of the sigmoids tested above, 2^-51 scaled to the floor and ceiling, carried through the
+logarithms of the terms, which is large where a probability is close to 0 or 1. Sets * saturated if one of them is so close
+that the vector kernel may take it as 0 or 1, and its term as -DBL_MAX */
+static double kernelTolerance(const struct binnedData * data, int func, int degree, const double * c, double sum, int * saturated) {
+    int link = func / 2, floorAndCeiling = func % 2;
+    const double * coefficients = floorAndCeiling ? c + 2 : c;
+    double scale = floorAndCeiling ? 0.5 - c[1] : 0.5;
+    double error = 0x1p-51 * fabs(scale) * 2.0, tolerance = 1e-12 * fabs(sum);
+    * saturated = 0;
+    for (int i = 0; i < data->bins; ++i) {
+        double result = coefficients[degree];
+        for (int k = degree - 1; k >= 0; --k)
+            result = result * data->age[i] + coefficients[k];
+        if (result <= 0.0) continue;
+        result = scalarLink(link, result) * scale + 0.5;
+        if (floorAndCeiling) result = result - c[1] + c[0];
+        if (data->deaths[i] > 0.0) {
+            tolerance += data->deaths[i] * error / result;
+            * saturated |= result <= 2.0 * error;
+        }
+        if (data->survivors[i] > 0.0) {
+            tolerance += data->survivors[i] * error / (1.0 - result);
+            * saturated |= 1.0 - result <= 2.0 * error;
+        }
+    }
+    return tolerance;
+}
+
+/* The vector kernels against the scalar one over all the bins of a cohort, for every function and order, at random points
+of the lattice around the seeds and at coefficients that make the probabilities reach 0 and 1 or the polynomial negative.
+The sums must be within kernelTolerance, or both -DBL_MAX or less, or both NaN where the polynomial overflows */
+static void testKernels(int level) {
+    enum { ROWS = 20000 };
+    static double ages[ROWS];
+    static int outcomes[ROWS];
+    cohortRows(ages, outcomes, ROWS, 0.1, 43);
+    uint64_t state = 47;
+    char details[256] = "";
+    long long compared = 0;
+    static const double extremes[] = {0.0, 1e-300, 1e-30, 1e-3, 0.5, 1.0, 1e3, 1e30, 1e300};
+    for (int order = 2; order <= 7 && !details[0]; ++order) {
+        dcContext * ctx = dcCreate(ages, outcomes, ROWS, order);
+        struct fitTask task;
+        task.result = NULL;
+        for (int func = 0; func < TOTAL_NUMBER_OF_FUNCTIONS && !details[0]; ++func) {
+            double (* kernel)(const struct binnedData *, const double *, double, int *) = level == 2 ? batchKernelsAvx512[func][order - 2]
+                                                                                                     : batchKernelsAvx2[func][order - 2];
+            for (int point = 0; point < 64 && !details[0]; ++point) {
+                double c[8];
+                randomStep(&task, ctx, func, &state);
+                for (int i = 0; i < 8; ++i)
+                    c[i] = task.candidates[i][nextRandom(&state) % 3];
+                if (point % 4 == 3)
+                    for (int i = 0; i < 8; ++i)
+                        c[i] = extremes[nextRandom(&state) % (sizeof(extremes) / sizeof(double))] * (nextRandom(&state) % 2 ? -1.0 : 1.0);
+                int abandoned = 0;
+                double vector = kernel(&ctx->data, c, -INFINITY, &abandoned);
+                double scalar = batchKernelsScalar[func][order - 2](&ctx->data, c, -INFINITY, &abandoned);
+                int saturated;
+                double tolerance = kernelTolerance(&ctx->data, func, KERNEL_DEGREE(func, order), c, scalar, &saturated);
+                ++compared;
+                if (!(fabs(vector - scalar) <= tolerance || (vector <= -DBL_MAX && (scalar <= -DBL_MAX || saturated)) || (isnan(vector) && isnan(scalar))))
+                    snprintf(details, sizeof(details), "function %d, order %d, c = %g %g %g %g %g %g %g %g: %.17g instead of %.17g",
+                             func, order, c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7], vector, scalar);
+            }
+        }
+        dcDestroy(ctx);
+    }
+    char name[128];
+    snprintf(name, sizeof(name), "simd: %lld sums of the %s kernels within the error of the probabilities of the scalar kernel", compared, level == 2 ? "AVX-512" : "AVX2");
+    report(name, details[0], details);
+}
+#endif
+
+/* The fits of several contexts at once from different threads of the process, with different numbers of threads of
+their own and both optimizers, must give the same functions, signs, and coefficients to the last bit as the fits of
+the same cohorts one after another with one thread each */
+#define CONCURRENT_COHORTS 3
+#define CONCURRENT_FITS 8
+
+struct concurrentFit {
+    const double * ages;
+    const int * outcomes;
+    int rows, order, threads, optimizer;
+    double output[9];
+    int func, sign1, failed;
+};
+
+static const int concurrentFunctions[TOTAL_NUMBER_OF_FUNCTIONS] = {1, 0, 0, 0, 0, 0, 0, 1, 0, 0};
+
+static void * concurrentFitThread(void * arg) {
+    struct concurrentFit * fit = arg;
+    dcContext * ctx = dcCreate(fit->ages, fit->outcomes, fit->rows, fit->order);
+    if (!ctx) {
+        fit->failed = 1;
+        return NULL;
+    }
+    dcSetConsole(ctx, 0);
+    dcSetThreads(ctx, fit->threads);
+    dcSetOptimizer(ctx, fit->optimizer);
+    fit->sign1 = 0;
+    fit->func = dcFit(ctx, fit->output, &fit->sign1, 0, concurrentFunctions);
+    fit->failed = fit->func < 0;
+    dcDestroy(ctx);
+    return NULL;
+}
+
+static void testConcurrentFits(void) {
+    enum { ROWS = 1000 };
+    static double ages[CONCURRENT_COHORTS][ROWS];
+    static int outcomes[CONCURRENT_COHORTS][ROWS];
+    struct concurrentFit serial[CONCURRENT_COHORTS][2], concurrent[CONCURRENT_FITS];
+    for (int k = 0; k < CONCURRENT_COHORTS; ++k) {
+        cohortRows(ages[k], outcomes[k], ROWS, k ? 1.0 : 0.1, 53 + k);
+        for (int optimizer = 0; optimizer < 2; ++optimizer) {
+            struct concurrentFit * fit = &serial[k][optimizer];
+            memset(fit, 0, sizeof(* fit));
+            fit->ages = ages[k];
+            fit->outcomes = outcomes[k];
+            fit->rows = ROWS;
+            fit->order = 2 + k % 2;
+            fit->threads = 1;
+            fit->optimizer = optimizer ? DC_OPTIMIZER_LBFGS : DC_OPTIMIZER_LATTICE;
+            concurrentFitThread(fit);
+        }
+    }
+    pthread_t threads[CONCURRENT_FITS];
+    int started = 0;
+    for (int i = 0; i < CONCURRENT_FITS; ++i) {
+        concurrent[i] = serial[i % CONCURRENT_COHORTS][i / CONCURRENT_COHORTS % 2];
+        concurrent[i].threads = 1 + i % 4;
+        memset(concurrent[i].output, 0, sizeof(concurrent[i].output));
+        started += pthread_create(&threads[i], NULL, concurrentFitThread, &concurrent[i]) == 0;
+    }
+    for (int i = 0; i < started; ++i)
+        pthread_join(threads[i], NULL);
+    char details[256] = "";
+    if (started < CONCURRENT_FITS)
+        snprintf(details, sizeof(details), "only %d of %d threads could be started", started, CONCURRENT_FITS);
+    for (int i = 0; i < started && !details[0]; ++i) {
+        const struct concurrentFit * reference = &serial[i % CONCURRENT_COHORTS][i / CONCURRENT_COHORTS % 2];
+        const struct concurrentFit * fit = &concurrent[i];
+        if (reference->failed || fit->failed)
+            snprintf(details, sizeof(details), "the fit of the cohort %d failed", i % CONCURRENT_COHORTS);
+        else if (fit->func != reference->func || fit->sign1 != reference->sign1 || memcmp(fit->output, reference->output, sizeof(fit->output)))
+            snprintf(details, sizeof(details), "the cohort %d with %d threads: function %d, signs x%02x, ML %.17g instead of function %d, signs x%02x, ML %.17g",
+                     i % CONCURRENT_COHORTS, fit->threads, fit->func, fit->sign1, fit->output[8], reference->func, reference->sign1, reference->output[8]);
+    }
+    char name[128];
+    snprintf(name, sizeof(name), "contexts: %d fits from different threads equal to the serial fits to the last bit", CONCURRENT_FITS);
+    report(name, details[0], details);
+}
+
+/* The bootstrap of one seed must give the same replicates, and so the same percentiles, to the last bit with one thread
+and with several, and with more replicates than one round of them queues at once */
+#define BOOTSTRAP_REPLICATES (BOOTSTRAP_ROUND + 6)
+
+static void testBootstrap(void) {
+    enum { ROWS = 1000, AGES = 5, LEVELS = 3 };
+    static double ages[ROWS];
+    static int outcomes[ROWS];
+    static double coefficients[2][9 * BOOTSTRAP_REPLICATES];
+    static const int functions[TOTAL_NUMBER_OF_FUNCTIONS] = {0, 0, 0, 0, 1, 0, 0, 0, 0, 0};
+    const double grid[AGES] = {20.0, 40.0, 60.0, 80.0, 95.0}, levels[LEVELS] = {0.025, 0.5, 0.975};
+    double bands[2][LEVELS * AGES], output[9];
+    int done[2] = {-1, -1}, sign1 = 0, func = -1;
+    cohortRows(ages, outcomes, ROWS, 1.0, 59);
+    dcContext * ctx = dcCreate(ages, outcomes, ROWS, 2);
+    if (ctx) {
+        dcSetConsole(ctx, 0);
+        dcSetThreads(ctx, 1);
+        func = dcFit(ctx, output, &sign1, 1, functions);
+        for (int run = 0; run < 2 && func >= 0; ++run) {
+            dcSetThreads(ctx, run ? 4 : 1);
+            done[run] = dcBootstrap(ctx, func, sign1, output, BOOTSTRAP_REPLICATES, 61, grid, AGES, levels, LEVELS, bands[run], coefficients[run]);
+        }
+        dcDestroy(ctx);
+    }
+    char details[256] = "";
+    if (func < 0 || done[0] < 0 || done[1] < 0)
+        snprintf(details, sizeof(details), "the fit or a bootstrap failed");
+    else if (done[0] != BOOTSTRAP_REPLICATES || done[1] != BOOTSTRAP_REPLICATES)
+        snprintf(details, sizeof(details), "%d and %d of %d replicates were fitted", done[0], done[1], BOOTSTRAP_REPLICATES);
+    else if (memcmp(coefficients[0], coefficients[1], sizeof(coefficients[0])) || memcmp(bands[0], bands[1], sizeof(bands[0])))
+        snprintf(details, sizeof(details), "the median at the age 80 is %.17g with one thread and %.17g with four", bands[0][AGES + 3], bands[1][AGES + 3]);
+    char name[128];
+    snprintf(name, sizeof(name), "bootstrap: %d replicates and their percentiles equal with 1 and 4 threads to the last bit", BOOTSTRAP_REPLICATES);
+    report(name, details[0], details);
+}
+
+/* The fits of the checkpoint tests below: two functions with all the sets of signs, one after another */
+static const int checkpointFunctions[TOTAL_NUMBER_OF_FUNCTIONS] = {0, 1, 0, 0, 1, 0, 0, 0, 0, 0};
+
+/* a checkpoint file of this process in /tmp, which the test removes */
+static void checkpointPath(char * path, size_t size, const char * name, int index) {
+    snprintf(path, size, "/tmp/deathcurve_test_%d_%s%d.ckpt", (int) getpid(), name, index);
+}
+
+/* fits the cohort with the checkpoint functions on a context of its own; returns what dcFit returns, or -1 if the
+context could not be created */
+static int checkpointFit(const double * ages, const int * outcomes, int rows, int threads, const char * checkpoint, int shardIndex, int shardCount,
+                         const atomic_int * cancel, double * output, int * sign1) {
+    dcContext * ctx = dcCreate(ages, outcomes, rows, 2);
+    if (!ctx) return -1;
+    dcSetConsole(ctx, 0);
+    dcSetThreads(ctx, threads);
+    dcSetCancelFlag(ctx, cancel);
+    int func = -1;
+    * sign1 = 0;
+    if ((!checkpoint || dcSetCheckpoint(ctx, checkpoint, 0.0) == 0) && dcSetShard(ctx, shardIndex, shardCount) == 0)
+        func = dcFit(ctx, output, sign1, 0, checkpointFunctions);
+    dcDestroy(ctx);
+    return func;
+}
+
+/* The shards of a fit, each with its own checkpoint, merged by dcMergeShards in another order, must give the same
+function, signs, and output to the last bit as the fit of the whole list, and a shard stopped before its fits
+finished must make the merge return -2 */
+#define SHARDS 3
+
+static void testShards(void) {
+    enum { ROWS = 1000 };
+    static double ages[ROWS];
+    static int outcomes[ROWS];
+    cohortRows(ages, outcomes, ROWS, 0.5, 67);
+    char paths[SHARDS][128], details[256] = "";
+    const char * reversed[SHARDS];
+    double reference[9], output[9], maxAge;
+    int referenceSign, sign1, referenceFunc = checkpointFit(ages, outcomes, ROWS, 2, NULL, 0, 1, NULL, reference, &referenceSign);
+    for (int i = 0; i < SHARDS; ++i) {
+        checkpointPath(paths[i], sizeof(paths[i]), "shard", i);
+        reversed[SHARDS - 1 - i] = paths[i];
+        if (checkpointFit(ages, outcomes, ROWS, 1 + i, paths[i], i, SHARDS, NULL, output, &sign1) < 0 && !details[0])
+            snprintf(details, sizeof(details), "the fit of the shard %d failed", i);
+    }
+    if (referenceFunc < 0 && !details[0])
+        snprintf(details, sizeof(details), "the fit of the whole list failed");
+    int merged = details[0] ? -1 : dcMergeShards(reversed, SHARDS, output, &sign1, &maxAge);
+    if (!details[0] && (merged != referenceFunc || sign1 != referenceSign || memcmp(output, reference, sizeof(output))))
+        snprintf(details, sizeof(details), "the merge gives function %d, signs x%02x, ML %.17g instead of function %d, signs x%02x, ML %.17g",
+                 merged, sign1, output[8], referenceFunc, referenceSign, reference[8]);
+    /* the shard 1 again, stopped before its first fit, leaves its fits unfinished in its checkpoint */
+    static atomic_int cancelled = 1;
+    if (!details[0]) {
+        checkpointFit(ages, outcomes, ROWS, 1, paths[1], 1, SHARDS, &cancelled, output, &sign1);
+        merged = dcMergeShards(reversed, SHARDS, output, &sign1, &maxAge);
+        if (merged != -2)
+            snprintf(details, sizeof(details), "the merge with an unfinished shard returns %d instead of -2", merged);
+    }
+    for (int i = 0; i < SHARDS; ++i)
+        remove(paths[i]);
+    char name[128];
+    snprintf(name, sizeof(name), "shards: %d shards merged equal to the whole fit to the last bit, and -2 with one unfinished", SHARDS);
+    report(name, details[0], details);
+}
+
+/* The progress callback of a fit that the test stops after a number of steps, each of which writes the checkpoint */
+struct stopAfter {
+    atomic_int cancelled;
+    int steps, after;
+};
+
+static void stopAfterSteps(const dcProgress * progress, void * userData) {
+    struct stopAfter * stop = userData;
+    (void) progress;
+    if (++stop->steps == stop->after)
+        atomic_store(&stop->cancelled, 1);
+}
+
+/* A fit stopped through its cancel flag after some of its steps and resumed from its checkpoint, with another number
+of threads than it was stopped with, must give the same function, signs, and output to the last bit as the fit that
+was not interrupted */
+static void testResume(void) {
+    enum { ROWS = 1000 };
+    static double ages[ROWS];
+    static int outcomes[ROWS];
+    static const int threads[][2] = {{1, 3}, {3, 1}, {2, 2}};
+    cohortRows(ages, outcomes, ROWS, 0.1, 71);
+    double reference[9], output[9];
+    int referenceSign, sign1, resumed = 0;
+    int referenceFunc = checkpointFit(ages, outcomes, ROWS, 1, NULL, 0, 1, NULL, reference, &referenceSign);
+    char path[128], details[256] = "";
+    checkpointPath(path, sizeof(path), "resume", 0);
+    if (referenceFunc < 0)
+        snprintf(details, sizeof(details), "the uninterrupted fit failed");
+    for (int i = 0; i < (int) (sizeof(threads) / sizeof(threads[0])) && !details[0]; ++i) {
+        struct stopAfter stop = { .steps = 0, .after = 25 + 40 * i };
+        atomic_init(&stop.cancelled, 0);
+        dcContext * ctx = dcCreate(ages, outcomes, ROWS, 2);
+        int func = -1;
+        if (ctx && dcSetCheckpoint(ctx, path, 0.0) == 0) {
+            dcSetConsole(ctx, 0);
+            dcSetThreads(ctx, threads[i][0]);
+            dcSetCancelFlag(ctx, &stop.cancelled);
+            dcSetProgress(ctx, stopAfterSteps, &stop, 0.0);
+            sign1 = 0;
+            func = dcFit(ctx, output, &sign1, 0, checkpointFunctions);
+        }
+        dcDestroy(ctx);
+        if (func < 0 || !atomic_load(&stop.cancelled)) {
+            snprintf(details, sizeof(details), "the fit with %d threads %s", threads[i][0], func < 0 ? "failed" : "finished before it was stopped");
+            break;
+        }
+        ctx = dcCreate(ages, outcomes, ROWS, dcCheckpointOrder(path));
+        func = -1;
+        if (ctx) {
+            dcSetConsole(ctx, 0);
+            dcSetThreads(ctx, threads[i][1]);
+            func = dcResume(ctx, path, output, &sign1);
+        }
+        dcDestroy(ctx);
+        if (func != referenceFunc || sign1 != referenceSign || memcmp(output, reference, sizeof(output)))
+            snprintf(details, sizeof(details), "stopped after %d steps with %d threads and resumed with %d: function %d, signs x%02x, ML %.17g instead of function %d, signs x%02x, ML %.17g",
+                     stop.after, threads[i][0], threads[i][1], func, sign1, output[8], referenceFunc, referenceSign, reference[8]);
+        ++resumed;
+    }
+    remove(path);
+    char name[128];
+    snprintf(name, sizeof(name), "resume: %d fits stopped and resumed with other numbers of threads equal to the uninterrupted fit to the last bit", resumed);
+    report(name, details[0], details);
+}
+
+/* The fits with the grid points never abandoned, without the lattice cache, and without both must give the same
+functions, signs, and outputs to the last bit as the default fit, which must have abandoned points and taken points from
+the cache, with both optimizers */
+static void testPruningAndCache(void) {
+    enum { ROWS = 1000 };
+    static double ages[ROWS];
+    static int outcomes[ROWS];
+    static const char * const variants[4] = {"the default", "no pruning", "no cache", "neither"};
+    cohortRows(ages, outcomes, ROWS, 0.1, 73);
+    char details[256] = "";
+    for (int optimizer = 0; optimizer < 2 && !details[0]; ++optimizer) {
+        double outputs[4][9];
+        int funcs[4], signs[4];
+        dcCounters counters[4];
+        for (int variant = 0; variant < 4; ++variant) {
+            dcContext * ctx = dcCreate(ages, outcomes, ROWS, 2);
+            funcs[variant] = -1;
+            signs[variant] = 0;
+            memset(&counters[variant], 0, sizeof(dcCounters));
+            if (!ctx) continue;
+            dcSetConsole(ctx, 0);
+            dcSetThreads(ctx, 2);
+            dcSetOptimizer(ctx, optimizer ? DC_OPTIMIZER_LBFGS : DC_OPTIMIZER_LATTICE);
+            ctx->noPruning = variant & 1;
+            ctx->noCache = variant >> 1;
+            funcs[variant] = dcFit(ctx, outputs[variant], &signs[variant], 0, checkpointFunctions);
+            dcGetCounters(ctx, &counters[variant]);
+            dcDestroy(ctx);
+        }
+        const char * name = optimizer ? "L-BFGS" : "the lattice";
+        if (funcs[0] < 0)
+            snprintf(details, sizeof(details), "the default fit with %s failed", name);
+        else if (!counters[0].abandoned || !counters[0].cacheHits)
+            snprintf(details, sizeof(details), "the default fit with %s abandoned %lld points and took %lld from the cache", name, counters[0].abandoned, counters[0].cacheHits);
+        for (int variant = 1; variant < 4 && !details[0]; ++variant) {
+            if ((variant & 1 && counters[variant].abandoned) || (variant >> 1 && counters[variant].cacheLookups))
+                snprintf(details, sizeof(details), "the fit with %s and %s abandoned %lld points and looked %lld up in the cache",
+                         name, variants[variant], counters[variant].abandoned, counters[variant].cacheLookups);
+            else if (funcs[variant] != funcs[0] || signs[variant] != signs[0] || memcmp(outputs[variant], outputs[0], sizeof(outputs[0])))
+                snprintf(details, sizeof(details), "the fit with %s and %s: function %d, signs x%02x, ML %.17g instead of function %d, signs x%02x, ML %.17g",
+                         name, variants[variant], funcs[variant], signs[variant], outputs[variant][8], funcs[0], signs[0], outputs[0][8]);
+        }
+    }
+    report("pruning: the fits without abandoning grid points and without the lattice cache equal to the default fits to the last bit", details[0], details);
+}
+
+int main(void) {
+    testBinning(1.0, 1e-12);
+    testBinning(0.1, 1e-12);
+    testBinningOrder();
+#if SIMD_KERNELS
+    pthread_once(&simdOnce_g, detectSimd);
+    for (int level = 1; level <= 2; ++level) {
+        if (level > simdLevel_g) {
+            printf("skip simd: the CPU has no %s\n", level == 2 ? "AVX-512" : "AVX2");
+            continue;
+        }
+        testApproximations(level);
+        testKernels(level);
+    }
+#else
+    report("simd: the scalar kernels are used without the vector ones", kernelFor(0, 2) != batchKernelsScalar[0][2 - 2], "a vector kernel was chosen");
+#endif
+    testConcurrentFits();
+    testBootstrap();
+    testShards();
+    testResume();
+    testPruningAndCache();
+    printf("%d test%s failed\n", failures, failures == 1 ? "" : "s");
+    return failures ? 1 : 0;
+}